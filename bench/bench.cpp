@@ -0,0 +1,105 @@
+#include "bench.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace bench
+{
+    namespace
+    {
+        struct suite
+        {
+            std::string_view name;
+            void (*fn)();
+        };
+
+        std::vector<suite>& suites()
+        {
+            static auto all = std::vector<suite>();
+            return all;
+        }
+
+        // the task pool's workers allocate too
+        std::atomic<std::size_t> alloc_count{};
+    }
+
+    std::size_t allocations()
+    { return alloc_count.load(std::memory_order_relaxed); }
+
+    std::vector<str> gen_source(std::size_t rows, std::size_t max_tokens)
+    {
+        static constexpr const char* tokens[] = {
+            "int", "x", "=", "42", ";", " ", "  ", "if", "(", ")", "{", "}",
+            "return", "foo_bar", "3.14", "\"str\"", "'c'", "while", "+",
+            "unsigned", "counter", "->", "->next", "[", "]", "i", " ", ", ",
+            "size", "0", "1", "*", "&", " ", "node", "ptr", "::", "x", "y",
+            "for", "char", " ", "buf", " = ", "-", "// note", "/*", "*/",
+        };
+        auto mt = std::mt19937(42);
+        auto pick = std::uniform_int_distribution<std::size_t>(0, std::size(tokens) - 1);
+        auto len = std::uniform_int_distribution<std::size_t>(0, max_tokens);
+
+        auto src = std::vector<str>(rows);
+        for (auto& row : src)
+            for (auto n = len(mt); n; --n)
+                row.append(tokens[pick(mt)]);
+        return src;
+    }
+
+    registrar::registrar(std::string_view name, void (*fn)())
+    { suites().push_back({ name, fn }); }
+
+    double run(std::string_view name, const bench_fn& fn, std::chrono::milliseconds min_time)
+    {
+        using std::chrono::steady_clock,
+              std::chrono::duration;
+
+        fn(); // warm up caches and lazily allocated buffers
+
+        std::size_t iters = 0;
+        auto start = steady_clock::now();
+        auto elapsed = steady_clock::duration{};
+        do {
+            fn();
+            ++iters;
+            elapsed = steady_clock::now() - start;
+        } while (elapsed < min_time);
+
+        auto ns = duration<double, std::nano>(elapsed).count() / static_cast<double>(iters);
+        std::printf("  %-40.*s %14.1f ns/iter  (%zu iters)\n",
+                static_cast<int>(name.size()), name.data(), ns, iters);
+        return ns;
+    }
+}
+
+// counts the allocations behind every new, including the array forms
+void* operator new(std::size_t size)
+{
+    bench::alloc_count.fetch_add(1, std::memory_order_relaxed);
+    if (auto* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{ std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept
+{ std::free(p); }
+
+int main(int argc, char** argv)
+{
+    for (const auto& s : bench::suites()) {
+        if (argc > 1 && !std::strstr(s.name.data(), argv[1]))
+            continue;
+        std::printf("%.*s\n", static_cast<int>(s.name.size()), s.name.data());
+        s.fn();
+    }
+    return 0;
+}
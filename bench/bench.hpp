@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "../src/str.hpp"
+
+namespace bench
+{
+    using bench_fn = std::function<void()>;
+
+    // keeps the optimizer from discarding a result nobody reads
+    template<typename T>
+    inline void do_not_optimize(const T& value)
+    { asm volatile("" : : "r,m"(value) : "memory"); }
+
+    // runs `fn` repeatedly for at least `min_time` and prints the mean wall
+    // time per call, returns it in nanoseconds
+    double run(std::string_view name, const bench_fn& fn,
+            std::chrono::milliseconds min_time = std::chrono::milliseconds(300));
+
+    // heap allocations made so far by operator new
+    std::size_t allocations();
+
+    // deterministic rows of C-like tokens, up to `max_tokens` per row
+    std::vector<str> gen_source(std::size_t rows, std::size_t max_tokens = 60);
+
+    struct registrar
+    {
+        registrar(std::string_view name, void (*suite)());
+    };
+}
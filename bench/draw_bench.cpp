@@ -0,0 +1,79 @@
+#include <cstdio>
+
+#include "bench.hpp"
+#include "../src/draw.hpp"
+#include "../src/editor.hpp"
+
+namespace
+{
+    void draw_suite()
+    {
+        auto source = bench::gen_source(20000, 120);
+
+        bench::run("open 20000 rows + first frame 300x100", [&]() {
+            render_cache.clear();
+            auto ed = editor(100, 300);
+            ed.filename() = "bench.c";
+            ed.set_ft();
+            for (const auto& row : source)
+                ed.rows().emplace_back(row, ed.hl_syntax());
+            auto scr = screen(100, 300);
+            draw_rows(ed, scr);
+            bench::do_not_optimize(scr.at(0, 0));
+        });
+
+        auto ed = editor(100, 300);
+        for (auto& row : source)
+            ed.rows().emplace_back(std::move(row));
+        ed.filename() = "bench.c";
+        ed.set_ft();
+
+        std::size_t content_bytes = 0, render_bytes = 0, hl_bytes = 0, spans = 0;
+        for (std::size_t i = 0; i < ed.rows().size(); ++i) {
+            auto view = ed.row_view(i);
+            content_bytes += ed.rows()[i].size();
+            render_bytes += view.shared->expanded.size();
+            hl_bytes += view.hl().memory();
+            spans += view.hl().spans().size();
+        }
+        auto rows = static_cast<double>(ed.rows().size());
+        std::printf("  %.1f content bytes/row, %.1f render copy bytes/row\n",
+                static_cast<double>(content_bytes) / rows,
+                static_cast<double>(render_bytes) / rows);
+        std::printf("  %.1f runs/row, %.1f highlight bytes/row\n",
+                static_cast<double>(spans) / rows,
+                static_cast<double>(hl_bytes) / rows);
+
+        const auto& stats = render_cache.stats();
+        std::printf("  render cache: %zu hits, %zu misses (%.1f%% hit rate), %zu entries, %zu KiB\n",
+                stats.hits, stats.misses, stats.hit_rate() * 100, stats.entries, stats.bytes >> 10);
+
+        auto scr = screen(100, 300);
+        bench::run("draw_rows 300x100", [&]() {
+            ed.rowoff() = (ed.rowoff() + 100) % ed.rows().size();
+            scr.clear();
+            draw_rows(ed, scr);
+            bench::do_not_optimize(scr.at(0, 0));
+        });
+
+        // what a key press costs: the cursor moves and the frame is drawn
+        // and diffed, scrolling a line at a time or a screen at a time
+        for (auto step : { std::size_t{1}, std::size_t{100} }) {
+            ed.rowoff() = 0;
+            ed.c_row() = 0;
+            auto frames = std::size_t{};
+            auto bytes = std::size_t{};
+            auto allocs = bench::allocations();
+            bench::run(step == 1 ? "refresh_screen 300x100, arrow down" : "refresh_screen 300x100, page down", [&]() {
+                ed.c_row() = (ed.c_row() + step) % ed.rows().size();
+                bytes += draw_frame(ed).size();
+                ++frames;
+            });
+            std::printf("  %.1f bytes/frame, %.2f allocations/frame\n",
+                    static_cast<double>(bytes) / static_cast<double>(frames),
+                    static_cast<double>(bench::allocations() - allocs) / static_cast<double>(frames));
+        }
+    }
+
+    bench::registrar reg("draw", &draw_suite);
+}
@@ -0,0 +1,87 @@
+#include <cstdio>
+
+#include "bench.hpp"
+#include "../src/editor.hpp"
+
+namespace
+{
+    void edit_suite()
+    {
+        // typing rarely produces a row seen before, keep the cache out of it
+        render_cache.set_budget(0);
+        for (auto tabs : { false, true }) {
+            auto ed = editor(100, 300);
+            ed.filename() = "bench.c";
+            ed.set_ft();
+
+            // one long row without comments, edited in the middle
+            auto line = str();
+            for (auto& piece : bench::gen_source(2000, 40)) {
+                if (piece.find('/') != str::npos)
+                    continue;
+                line.append(piece);
+                if (tabs)
+                    line.push_back('\t');
+            }
+            ed.rows().emplace_back(line, ed.hl_syntax());
+
+            auto name = tabs ? "keystroke, 1 row of %zu cols with tabs" : "keystroke, 1 row of %zu cols";
+            char title[64];
+            std::snprintf(title, sizeof(title), name, line.size());
+            bench::run(title, [&]() {
+                ed.c_row() = 0;
+                ed.c_col() = line.size() / 2;
+                ed.insert_char('x');
+                bench::do_not_optimize(ed.row_view(0).render.data());
+                ed.delete_char();
+                bench::do_not_optimize(ed.row_view(0).render.data());
+            });
+        }
+        render_cache.set_budget(row_cache::DEFAULT_BUDGET);
+
+        // 2000 lines pasted into the middle of a file, then the rows on
+        // screen at the cursor highlighted
+        auto source = bench::gen_source(3000, 40);
+        auto text = str();
+        for (std::size_t i = 0; i < 2000; ++i) {
+            text.append(source[i]);
+            text.push_back('\r');
+        }
+        auto paste_into = [&](auto&& insert) {
+            auto ed = editor(100, 300);
+            ed.filename() = "bench.c";
+            ed.set_ft();
+            for (const auto& line : source)
+                ed.rows().emplace_back(line, ed.hl_syntax());
+            ed.c_row() = 1500;
+            insert(ed);
+            for (auto row = ed.c_row() - 50; row <= ed.c_row(); ++row)
+                bench::do_not_optimize(ed.row_view(row).render.data());
+        };
+        bench::run("paste 2000 lines, key by key", [&]() {
+            paste_into([&](editor& ed) {
+                for (auto c : text) {
+                    if (c == '\r')
+                        ed.insert_newline();
+                    else
+                        ed.insert_char(c);
+                }
+            });
+        });
+        bench::run("paste 2000 lines at once", [&]() {
+            paste_into([&](editor& ed) { ed.paste(text); });
+        });
+        bench::run("erase 2000 lines, key by key", [&]() {
+            paste_into([&](editor& ed) {
+                ed.c_row() = 2500;
+                while (ed.c_row() > 500 || ed.c_col())
+                    ed.delete_char();
+            });
+        });
+        bench::run("erase 2000 lines at once", [&]() {
+            paste_into([&](editor& ed) { ed.erase_range({ 500, 0 }, { 2500, 0 }); });
+        });
+    }
+
+    bench::registrar reg("edit", &edit_suite);
+}
@@ -0,0 +1,30 @@
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "../src/highlight.hpp"
+
+namespace
+{
+    void highlight_suite()
+    {
+        const auto src = bench::gen_source(10000);
+        const auto& syntax = HLDB[0];
+        auto hl = std::vector<hl_runs>(src.size());
+
+        auto highlight_all = [&](hl_fn fn) {
+            return [&, fn]() {
+                auto state = hl_state();
+                for (std::size_t i = 0; i < src.size(); ++i)
+                    fn(syntax, { src[i].c_str(), src[i].size() }, hl[i], state);
+                bench::do_not_optimize(hl.back().spans().data());
+            };
+        };
+
+        auto generic = bench::run("generic (10k rows)", highlight_all(&hl_generic));
+        auto builtin = bench::run("c_policy (10k rows)", highlight_all(syntax.highlight));
+        std::printf("  speedup: %.2fx\n", generic / builtin);
+    }
+
+    bench::registrar reg("highlight", &highlight_suite);
+}
@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.hpp"
+#include "../src/editor.hpp"
+
+namespace
+{
+    void row_cache_suite()
+    {
+        // log-like input: few distinct lines repeated over and over
+        auto distinct = bench::gen_source(64, 30);
+        distinct.push_back("");
+        distinct.push_back("}");
+        auto mt = std::mt19937(7);
+        auto pick = std::uniform_int_distribution<std::size_t>(0, distinct.size() - 1);
+        auto lines = std::vector<str>(100000);
+        for (auto& line : lines)
+            line = distinct[pick(mt)];
+
+        auto load = [&]() {
+            auto rows = std::vector<editor_row>();
+            rows.reserve(lines.size());
+            auto state = hl_state();
+            for (const auto& line : lines) {
+                state = rows.emplace_back(line, &HLDB[0], state).view().exit_state();
+            }
+            bench::do_not_optimize(rows.back().view().render.data());
+        };
+
+        render_cache.clear();
+        render_cache.set_budget(0);
+        bench::run("load 100k repetitive rows, no cache", load);
+
+        render_cache.set_budget(row_cache::DEFAULT_BUDGET);
+        auto before = render_cache.stats();
+        bench::run("load 100k repetitive rows, cached", load);
+        const auto& stats = render_cache.stats();
+        auto hits = stats.hits - before.hits;
+        auto misses = stats.misses - before.misses;
+        std::printf("  hit rate %.2f%%, %zu entries, %zu KiB\n",
+                100.0 * static_cast<double>(hits) / static_cast<double>(hits + misses),
+                stats.entries, stats.bytes >> 10);
+    }
+
+    void render_suite()
+    {
+        // tab indented rows with an aligning tab now and then
+        auto rows = bench::gen_source(10000, 60);
+        auto mt = std::mt19937(3);
+        for (auto& row : rows) {
+            auto line = str();
+            line.append(mt() % 4, '\t');
+            for (auto c : row)
+                line.push_back(c == ';' && mt() % 2 ? '\t' : c);
+            row = line;
+        }
+
+        auto render = str();
+        auto tabs = std::vector<tab_stop>();
+        bench::run("render_content (10k tab indented rows)", [&]() {
+            for (const auto& row : rows) {
+                render_content(row, render, tabs);
+                bench::do_not_optimize(render.c_str());
+            }
+        });
+    }
+
+    bench::registrar reg("row_cache", &row_cache_suite);
+    bench::registrar reg_render("render", &render_suite);
+}
@@ -0,0 +1,64 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "bench.hpp"
+#include "../src/screen.hpp"
+
+namespace
+{
+    void fill_from(screen& scr, const std::vector<str>& source, std::size_t first)
+    {
+        static constexpr int palette[] = { colors::DEFAULT, colors::RED, colors::CYAN };
+        scr.clear();
+        for (std::size_t row = 0; row < scr.rows(); ++row) {
+            const auto& line = source[(first + row) % source.size()];
+            // a colour change every few columns, like highlighted code
+            for (std::size_t col = 0; col < line.size(); col += 6)
+                scr.put(row, col, { line.c_str() + col, std::min<std::size_t>(6, line.size() - col) },
+                        palette[(row + col) % std::size(palette)]);
+        }
+    }
+
+    void screen_suite()
+    {
+        auto source = bench::gen_source(1000, 120);
+        auto prev = screen(100, 300);
+        fill_from(prev, source, 0);
+
+        auto next = prev;
+        auto out = str();
+        auto report = [&](const char* name) {
+            out.clear();
+            diff_screen(prev, next, out);
+            std::printf("  %s: %zu bytes\n", name, out.size());
+            bench::run(name, [&]() {
+                out.clear();
+                diff_screen(prev, next, out);
+                bench::do_not_optimize(out.c_str());
+            });
+        };
+
+        report("diff 300x100, unchanged");
+
+        next.put(50, 150, "x");
+        report("diff 300x100, one cell");
+
+        next = prev;
+        next.put(50, 0, { source[7].c_str(), source[7].size() });
+        report("diff 300x100, one line");
+
+        fill_from(next, source, 1);
+        report("diff 300x100, scrolled a line");
+
+        out.clear();
+        diff_screen(screen(), next, out);
+        std::printf("  diff 300x100 onto an unknown screen: %zu bytes\n", out.size());
+        bench::run("diff 300x100 onto an unknown screen", [&]() {
+            out.clear();
+            diff_screen(screen(), next, out);
+            bench::do_not_optimize(out.c_str());
+        });
+    }
+
+    bench::registrar reg("screen", &screen_suite);
+}
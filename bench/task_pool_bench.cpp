@@ -0,0 +1,53 @@
+#include <cstdio>
+#include <unistd.h>
+
+#include "bench.hpp"
+#include "../src/command.hpp"
+#include "../src/editor.hpp"
+#include "../src/editor_keys.hpp"
+#include "../src/event_loop.hpp"
+#include "../src/file_io.hpp"
+#include "../src/task_pool.hpp"
+
+namespace
+{
+    void task_pool_suite()
+    {
+        std::printf("  %zu workers\n", workers.size());
+
+        static constexpr std::size_t ROWS = 200'000;
+        auto source = bench::gen_source(ROWS, 40);
+        char path[] = "/tmp/kilo_bench_XXXXXX";
+        auto fd = mkstemp(path);
+        for (const auto& line : source) {
+            write(fd, line.c_str(), line.size());
+            write(fd, "\n", 1);
+        }
+        close(fd);
+
+        bench::run("load 200000 lines", [&]() {
+            auto ed = editor(100, 300);
+            file::read_file(ed, path);
+            bench::do_not_optimize(ed.rows().back().text().data());
+        });
+
+        // a query only the last row holds, searched for from the first
+        auto ed = editor(100, 300);
+        file::read_file(ed, path);
+        ed.rows().back().content().append("needle");
+        ed.rows().back().upd_row();
+        // the search runs as a command, it is done once the main loop ran
+        // what it handed back
+        bench::run("search 200000 rows, match in the last", [&]() {
+            ed.incr_find("needle", editor_key::ESCAPE);
+            ed.incr_find("needle", 'e');
+            while (command::running())
+                main_loop.run_once(std::chrono::milliseconds(-1));
+            bench::do_not_optimize(ed.c_row());
+        });
+
+        unlink(path);
+    }
+
+    bench::registrar reg("task_pool", &task_pool_suite);
+}
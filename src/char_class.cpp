@@ -0,0 +1,243 @@
+#include "char_class.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    using mask_type = char_class::mask_type;
+
+    struct block_masks
+    {
+        mask_type digit, sep, quote, backslash, comment;
+    };
+
+    constexpr std::array<unsigned char, 256> gen_class_table()
+    {
+        auto table = std::array<unsigned char, 256>{};
+        for (unsigned char c = '0'; c <= '9'; ++c)
+            table[c] |= DIGIT;
+        for (unsigned char c : SEPARATORS)
+            table[c] |= SEPARATOR;
+        for (unsigned char c : std::string_view(" \t\n\v\f\r\0", 7))
+            table[c] |= SEPARATOR;
+        table[static_cast<unsigned char>('"')] |= QUOTE;
+        table[static_cast<unsigned char>('\'')] |= QUOTE;
+        table[static_cast<unsigned char>('\\')] |= BACKSLASH;
+        return table;
+    }
+
+    constexpr auto CLASS_TABLE = gen_class_table();
+
+    void classify_scalar(const char* s, std::string_view leads, block_masks& out)
+    {
+        out = {};
+        for (std::size_t i = 0; i < char_class::BLOCK; ++i) {
+            auto bit = mask_type{1} << i;
+            auto cls = CLASS_TABLE[static_cast<unsigned char>(s[i])];
+            if (cls & DIGIT)        out.digit |= bit;
+            if (cls & SEPARATOR)    out.sep |= bit;
+            if (cls & QUOTE)        out.quote |= bit;
+            if (cls & BACKSLASH)    out.backslash |= bit;
+            if (leads.find(s[i]) != std::string_view::npos)
+                out.comment |= bit;
+        }
+    }
+
+#if defined(__AVX2__)
+    using vec = __m256i;
+    constexpr std::size_t LANE = 32;
+
+    inline vec load(const char* s)
+    { return _mm256_loadu_si256(reinterpret_cast<const vec*>(s)); }
+
+    inline vec splat(char c)
+    { return _mm256_set1_epi8(c); }
+
+    inline vec eq(vec a, vec b)
+    { return _mm256_cmpeq_epi8(a, b); }
+
+    inline vec gt(vec a, vec b)
+    { return _mm256_cmpgt_epi8(a, b); }
+
+    inline vec bor(vec a, vec b)
+    { return _mm256_or_si256(a, b); }
+
+    inline vec band(vec a, vec b)
+    { return _mm256_and_si256(a, b); }
+
+    inline vec zero()
+    { return _mm256_setzero_si256(); }
+
+    inline mask_type bits(vec a)
+    { return static_cast<std::uint32_t>(_mm256_movemask_epi8(a)); }
+#elif defined(__SSE2__)
+    using vec = __m128i;
+    constexpr std::size_t LANE = 16;
+
+    inline vec load(const char* s)
+    { return _mm_loadu_si128(reinterpret_cast<const vec*>(s)); }
+
+    inline vec splat(char c)
+    { return _mm_set1_epi8(c); }
+
+    inline vec eq(vec a, vec b)
+    { return _mm_cmpeq_epi8(a, b); }
+
+    inline vec gt(vec a, vec b)
+    { return _mm_cmpgt_epi8(a, b); }
+
+    inline vec bor(vec a, vec b)
+    { return _mm_or_si128(a, b); }
+
+    inline vec band(vec a, vec b)
+    { return _mm_and_si128(a, b); }
+
+    inline vec zero()
+    { return _mm_setzero_si128(); }
+
+    inline mask_type bits(vec a)
+    { return static_cast<std::uint16_t>(_mm_movemask_epi8(a)); }
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    // comment leads are only known at runtime, broadcast them once per scan
+    struct lead_vecs
+    {
+        vec v[3];
+        std::size_t cnt;
+
+        lead_vecs(std::string_view leads)
+            : v{}
+            , cnt{std::min<std::size_t>(leads.size(), 3)}
+        {
+            for (std::size_t i = 0; i < cnt; ++i)
+                v[i] = splat(leads[i]);
+        }
+    };
+
+    using leads_type = lead_vecs;
+
+    inline vec in_range(vec v, char lo, char hi)
+    {
+        return band(gt(v, splat(static_cast<char>(lo - 1))),
+                gt(splat(static_cast<char>(hi + 1)), v));
+    }
+
+    void classify(const char* s, const leads_type& leads, block_masks& out)
+    {
+        out = {};
+        for (std::size_t off = 0; off < char_class::BLOCK; off += LANE) {
+            auto v = load(s + off);
+
+            // bytes >= 0x80 are negative and thus never inside a range
+            auto digit = in_range(v, '0', '9');
+            // isspace(), '\0' and SEPARATORS grouped into ascii ranges:
+            // ['\t', '\r'], ['\'', '/'] and [';', '>'] plus the stragglers
+            auto sep = bor(in_range(v, '\t', '\r'), eq(v, zero()));
+            sep = bor(sep, bor(in_range(v, '\'', '/'), in_range(v, ';', '>')));
+            sep = bor(sep, bor(eq(v, splat(' ')), eq(v, splat('"'))));
+            sep = bor(sep, bor(eq(v, splat('%')), eq(v, splat('~'))));
+            sep = bor(sep, bor(eq(v, splat('[')), eq(v, splat(']'))));
+            auto quote = bor(eq(v, splat('"')), eq(v, splat('\'')));
+            auto backslash = eq(v, splat('\\'));
+            auto comment = zero();
+            for (std::size_t i = 0; i < leads.cnt; ++i)
+                comment = bor(comment, eq(v, leads.v[i]));
+
+            out.digit |= bits(digit) << off;
+            out.sep |= bits(sep) << off;
+            out.quote |= bits(quote) << off;
+            out.backslash |= bits(backslash) << off;
+            out.comment |= bits(comment) << off;
+        }
+    }
+#else
+    using leads_type = std::string_view;
+
+    inline void classify(const char* s, const leads_type& leads, block_masks& out)
+    { classify_scalar(s, leads, out); }
+#endif
+}
+
+void find_all(const char* s, std::size_t len, char c, std::vector<std::uint32_t>& out)
+{
+    std::size_t off = 0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    auto needle = splat(c);
+    for (; off + LANE <= len; off += LANE)
+        for (auto m = bits(eq(load(s + off), needle)); m; m &= m - 1)
+            out.push_back(static_cast<std::uint32_t>(off + static_cast<std::size_t>(std::countr_zero(m))));
+#endif
+    for (; off < len; ++off)
+        if (s[off] == c)
+            out.push_back(static_cast<std::uint32_t>(off));
+}
+
+void char_class::scan(const char* s, std::size_t len, std::string_view comment_leads)
+{
+    m_src = s;
+    m_size = len;
+    m_leads_cnt = std::min(comment_leads.size(), std::size(m_leads));
+    std::copy_n(comment_leads.begin(), m_leads_cnt, m_leads);
+    m_lo = m_hi = 0;
+
+    auto words = (len + BLOCK - 1) / BLOCK;
+    for (auto& mask : m_masks)
+        mask.resize(words);
+}
+
+unsigned char_class::kinds_of(char c)
+{
+    return CLASS_TABLE[static_cast<unsigned char>(c)];
+}
+
+void char_class::classify_words(std::size_t from, std::size_t to) const
+{
+    auto masks = block_masks{};
+    auto leads = leads_type(std::string_view(m_leads, m_leads_cnt));
+    for (auto w = from; w < to; ++w) {
+        auto off = w * BLOCK;
+        if (off + BLOCK <= m_size) {
+            classify(m_src + off, leads, masks);
+        } else {
+            // zero pad the tail so the block loads never read past `s`
+            char tail[BLOCK]{};
+            std::memcpy(tail, m_src + off, m_size - off);
+            classify(tail, leads, masks);
+
+            auto valid = (mask_type{1} << (m_size - off)) - 1;
+            masks.digit &= valid;
+            masks.sep &= valid;
+            masks.quote &= valid;
+            masks.backslash &= valid;
+            masks.comment &= valid;
+        }
+        m_masks[0][w] = masks.digit;
+        m_masks[1][w] = masks.sep;
+        m_masks[2][w] = masks.quote;
+        m_masks[3][w] = masks.backslash;
+        m_masks[4][w] = masks.comment;
+    }
+}
+
+std::size_t char_class::next(unsigned kinds, std::size_t from) const
+{
+    if (from >= m_size)
+        return m_size;
+
+    auto w = from / BLOCK;
+    auto m = word(kinds, w) & (~mask_type{0} << (from % BLOCK));
+    for (auto words = m_masks[0].size(); !m && ++w < words;)
+        m = word(kinds, w);
+    if (!m)
+        return m_size;
+    return std::min(m_size, w * BLOCK + static_cast<std::size_t>(std::countr_zero(m)));
+}
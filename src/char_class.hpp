@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// character classes the highlighter cares about, one bitmask per class and
+// one bit per byte of the scanned buffer
+enum char_kind : unsigned
+{
+    DIGIT       = 1 << 0,
+    SEPARATOR   = 1 << 1,
+    QUOTE       = 1 << 2,
+    BACKSLASH   = 1 << 3,
+    COMMENT     = 1 << 4, // lead byte of a comment delimiter
+};
+
+static constexpr std::string_view SEPARATORS = ",.()+-/*=~%<>[];'\"";
+
+// appends the offset of every `c` among the `len` bytes of `s` to `out`,
+// comparing a vector register worth of bytes at a time
+void find_all(const char* s, std::size_t len, char c, std::vector<std::uint32_t>& out);
+
+class char_class
+{
+public:
+    using mask_type = std::uint64_t;
+
+    static constexpr std::size_t BLOCK = 64;
+
+    char_class() = default;
+
+    // classify `len` bytes of `s`, 64 bytes per mask word. `comment_leads`
+    // holds the first byte of every comment delimiter of the current syntax.
+    // words are only classified once queried, so `s` has to outlive the
+    // queries and looking at part of a long row only pays for that part
+    void scan(const char* s, std::size_t len, std::string_view comment_leads = {});
+
+    // the kinds `c` belongs to, ignoring COMMENT
+    static unsigned kinds_of(char c);
+
+    std::size_t size() const
+    { return this->m_size; }
+
+    // positions at or beyond the end count as separator, the same way the
+    // terminating '\0' of a row used to
+    bool test(unsigned kinds, std::size_t i) const
+    {
+        if (i >= m_size)
+            return kinds & SEPARATOR;
+        return word(kinds, i / BLOCK) >> (i % BLOCK) & 1;
+    }
+
+    bool is_digit(std::size_t i) const
+    { return test(DIGIT, i); }
+
+    bool is_sep(std::size_t i) const
+    { return test(SEPARATOR, i); }
+
+    // first position >= `from` of any of `kinds`, size() if there is none
+    std::size_t next(unsigned kinds, std::size_t from) const;
+
+private:
+    const char* m_src{};
+    std::size_t m_size{};
+    char m_leads[3]{};
+    std::size_t m_leads_cnt{};
+    // words [m_lo, m_hi) are classified
+    mutable std::size_t m_lo{}, m_hi{};
+    mutable std::array<std::vector<mask_type>, 5> m_masks{};
+
+    void classify_words(std::size_t from, std::size_t to) const;
+
+    mask_type word(unsigned kinds, std::size_t w) const
+    {
+        if (w < m_lo || w >= m_hi) {
+            if (m_lo == m_hi)
+                m_lo = m_hi = w;
+            if (w < m_lo)
+                classify_words(w, m_lo), m_lo = w;
+            else
+                classify_words(m_hi, w + 1), m_hi = w + 1;
+        }
+        mask_type m = 0;
+        for (std::size_t k = 0; k < m_masks.size(); ++k)
+            if (kinds & (1u << k))
+                m |= m_masks[k][w];
+        return m;
+    }
+};
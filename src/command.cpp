@@ -0,0 +1,136 @@
+#include "command.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <format>
+#include <memory>
+
+#include "event_loop.hpp"
+
+namespace command
+{
+    namespace
+    {
+        // the command started last, used on the main loop's thread only
+        struct current_command
+        {
+            std::uint64_t generation{};
+            // works not done yet, cancelled ones included
+            std::size_t active{};
+            str name{};
+            // the message shown before the progress took its place
+            str shown_before{};
+            cancel_token token{};
+            bool report_cancel{};
+            status_message* msg{};
+            // what the command's work handed back, held until the work of
+            // the commands cancelled before it is done too
+            finish pending{};
+            bool done{};
+            // the work committed, `pending` runs even if cancelled since
+            bool committed{};
+        };
+
+        current_command current;
+
+        // runs what the current command handed back once no work reads the
+        // text any more, what it runs may change it
+        void run_pending()
+        {
+            if (current.active || !current.done)
+                return;
+            current.done = false;
+            auto done = std::move(current.pending);
+            current.pending = {};
+            if (current.token.cancelled() && !current.committed) {
+                if (current.report_cancel)
+                    current.msg->set_content(
+                            std::format("{} cancelled", current.name.c_str()).c_str());
+                return;
+            }
+            current.msg->set_content(current.shown_before);
+            if (done)
+                done();
+        }
+
+        // runs on the main loop's thread once the work of `p`'s command
+        // returned `done`, or threw `error`
+        void complete(const progress& p, finish done, const str* error)
+        {
+            --current.active;
+            if (p.generation() == current.generation) {
+                if (p.cancelled() && !p.committed()) {
+                    if (current.report_cancel)
+                        current.msg->set_content(
+                                std::format("{} cancelled", current.name.c_str()).c_str());
+                } else if (error) {
+                    current.msg->set_content(
+                            std::format("{} failed: {}", current.name.c_str(), error->c_str()).c_str());
+                } else {
+                    current.pending = std::move(done);
+                    current.done = true;
+                    current.committed = p.committed();
+                }
+            }
+            run_pending();
+        }
+    }
+
+    void progress::report(std::size_t done, std::size_t total)
+    {
+        auto percent = total ? static_cast<int>(std::min(done, total) * 100 / total) : 100;
+        if (m_percent.exchange(percent, std::memory_order_relaxed) == percent)
+            return;
+
+        main_loop.post([generation = m_generation, percent]() {
+            if (generation != current.generation || current.token.cancelled())
+                return;
+            current.msg->set_content(std::format("{} {}% (ESC to cancel)",
+                        current.name.c_str(), percent).c_str());
+        });
+    }
+
+    void start(status_message& msg, str name, work fn)
+    {
+        cancel(false);
+        ++current.active;
+        current.name = std::move(name);
+        current.shown_before = msg.content();
+        current.token = cancel_token();
+        current.report_cancel = true;
+        current.msg = &msg;
+        current.pending = {};
+        current.done = false;
+        current.committed = false;
+
+        // the pool gets no token, a task it dropped would never report back
+        auto p = std::make_shared<progress>(++current.generation, current.token);
+        workers.submit([p, fn = std::move(fn)]() {
+            auto done = finish();
+            auto error = str();
+            auto failed = false;
+            try {
+                done = fn(*p);
+            } catch (const std::exception& e) {
+                error = e.what();
+                failed = true;
+            }
+            main_loop.post([p, done = std::move(done), error = std::move(error), failed]() {
+                complete(*p, done, failed ? &error : nullptr);
+            });
+        }, task_priority::INTERACTIVE);
+    }
+
+    bool running()
+    {
+        return current.active || current.done;
+    }
+
+    void cancel(bool report)
+    {
+        if (!running())
+            return;
+        current.token.cancel();
+        current.report_cancel = report;
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "status_message.hpp"
+#include "str.hpp"
+#include "task_pool.hpp"
+
+// commands that take long, like a search through a big file or a save to a
+// slow disk, run on the task pool while keys and frames go on being handled.
+// A command reports how far it got in the message bar and stops when
+// cancelled. While one runs the text must not change under it, the keys
+// that would change it wait for it to finish
+namespace command
+{
+    // handed to a command's work on the worker running it
+    class progress
+    {
+    public:
+        progress(std::uint64_t generation, cancel_token token)
+            : m_generation{generation}
+            , m_token{std::move(token)}
+        { }
+
+        std::uint64_t generation() const
+        { return this->m_generation; }
+
+        const cancel_token& token() const
+        { return this->m_token; }
+
+        bool cancelled() const
+        { return this->m_token.cancelled(); }
+
+        // the work got to where it can't be taken back, like a file written
+        // over: what it returns runs even when cancelled after this. From
+        // here on the work doesn't look at cancelled() any more
+        void commit()
+        { this->m_committed.store(true, std::memory_order_release); }
+
+        bool committed() const
+        { return this->m_committed.load(std::memory_order_acquire); }
+
+        // `done` of `total` steps, shown once the percentage changed
+        void report(std::size_t done, std::size_t total);
+
+    private:
+        std::uint64_t m_generation;
+        cancel_token m_token;
+        std::atomic<int> m_percent{-1};
+        std::atomic<bool> m_committed{};
+    };
+
+    // what a command's work hands back to run on the main loop's thread,
+    // e.g. to put what it found into the editor
+    using finish = std::function<void()>;
+    using work = std::function<finish(progress&)>;
+
+    // runs `work` on a worker and shows "`name` n%" in `msg` while it runs.
+    // Once it is done the message goes back to what it was and what the work
+    // returned runs, unless the command was cancelled before it committed
+    // or threw. A command
+    // already running is cancelled first, without a word; what the new one
+    // returns waits until the cancelled work stopped reading the text too
+    void start(status_message& msg, str name, work);
+
+    // whether the work of a command may still be running
+    bool running();
+
+    // asks the running command to stop, it says so in the message bar once
+    // it has when `report`
+    void cancel(bool report = true);
+}
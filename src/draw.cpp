@@ -1,118 +1,147 @@
 #include <cctype>
-#include <chrono>
-#include <format>
 #include <functional>
 #include <numeric>
+#include <span>
 #include <string_view>
 #include <type_traits>
+#include <utility>
+#include <vector>
 #include <unistd.h>
 
 #include "draw.hpp"
 #include "editor.hpp"
 #include "editor_keys.hpp"
+#include "render_thread.hpp"
+#include "screen.hpp"
 #include "str.hpp"
 
 static constexpr std::string_view KILO_VERS = "0.0.1";
 
 using namespace char_seq;
 
-void print_welcome(editor& ed, str& buf)
+void print_welcome(editor& ed, std::size_t row, screen& scr)
 {
-    auto msg = std::format("Kilo editor -- version {}", KILO_VERS);
-    if (msg.size() > ed.screen_col())
+    static constexpr std::string_view msg = "Kilo editor -- version ";
+    auto len = msg.size() + KILO_VERS.size();
+    if (len > ed.screen_col())
         return;
 
-    auto padding = (ed.screen_col() - msg.size() - 1) / 2;
-    if (padding) {
-        buf.push_back('~');
-        --padding;
-    }
-    while (padding--)
-        buf.push_back(' ');
-    buf.append(msg.c_str());
+    auto padding = (ed.screen_col() - len - 1) / 2;
+    if (padding)
+        scr.put(row, 0, "~");
+    scr.put(row, scr.put(row, padding, msg), KILO_VERS);
 }
 
-void draw_status_msg_bar(editor& ed, str& buf)
+void draw_status_msg_bar(editor& ed, screen& scr)
 {
-    using std::chrono::time_point,
-          std::chrono::system_clock,
-          std::chrono::duration_cast,
-          std::chrono::seconds;
-    static auto diff_time = [](const time_point<system_clock>& ts) {
-        return duration_cast<seconds>(system_clock::now() - ts).count();
-    };
-
-    buf.append(esc_seq::CLEAR_LINE);
+    // input handling expires the message on a timer, drawing never looks
+    // at the clock
     const auto& msg = ed.status_msg();
-    if (!msg.content().empty() && diff_time(msg.timestamp()) < 2)
-        buf.append(msg.content(), ed.screen_col());
+    if (!msg.content().empty() && !msg.expired())
+        scr.put(ed.screen_row() + 1, 0, { msg.content().c_str(), msg.content().size() });
 }
 
-void draw_statusbar(editor& ed, str& buf)
+void draw_statusbar(editor& ed, screen& scr)
 {
-    buf.append(esc_seq::INVERT_COLOR);
-
-    auto file_info = str(std::format("KILO_EDITOR | {} - {} lines{}",
-                (ed.filename().empty() ?
-                 "[No Name]" : ed.filename().c_str()),
-                ed.rows().size(),
-                (ed.dirty() ? " [+]" : "")).c_str());
-    auto line_info = str(std::format("{}:{} | {}",
-                ed.c_row() + 1, ed.c_col() + 1,
-                (ed.hl_syntax().has_value() ? ed.hl_syntax()->filetype.c_str() : "no ft")
-                ).c_str());
-
-    file_info.resize(ed.screen_col() - line_info.size(), ' ');
-    buf.append(std::move(file_info));
-    buf.append(std::move(line_info));
-
-    buf.append(esc_seq::RESET_COLOR);
-    buf.append(NEW_LINE);
+    // kept across frames, drawing allocates nothing once they have grown
+    static auto file_info = str();
+    static auto line_info = str();
+
+    auto row = ed.screen_row();
+    file_info.clear();
+    file_info.append("KILO_EDITOR | ");
+    file_info.append(ed.filename().empty() ? "[No Name]" : ed.filename().c_str());
+    file_info.append(" - ");
+    append_dec(ed.rows().size(), file_info);
+    file_info.append(" lines");
+    if (ed.dirty())
+        file_info.append(" [+]");
+
+    auto filetype = ed.hl_syntax() ? ed.hl_syntax()->filetype : "no ft";
+    line_info.clear();
+    append_dec(ed.c_row() + 1, line_info);
+    line_info.push_back(':');
+    append_dec(ed.c_col() + 1, line_info);
+    line_info.append(" | ");
+    line_info.append(filetype.data(), filetype.size());
+
+    auto info_col = ed.screen_col() - std::min(line_info.size(), ed.screen_col());
+    scr.fill(row, 0, ed.screen_col(), ' ', colors::DEFAULT, cell::INVERT);
+    scr.put(row, 0, { file_info.c_str(), std::min(file_info.size(), info_col) },
+            colors::DEFAULT, cell::INVERT);
+    scr.put(row, info_col, { line_info.c_str(), line_info.size() },
+            colors::DEFAULT, cell::INVERT);
 }
 
-void pad_hl(char hl, str& buf)
+// calls `emit(from, to, color)` for every maximal stretch of [from, to)
+// with one colour, overlays win over the row's own runs
+template<typename fn>
+static void for_each_color_run(const hl_runs& hl, std::span<const hl_span> overlay,
+        std::size_t from, std::size_t to, fn emit)
 {
-    char hl_code[16]{};
-    auto len = snprintf(hl_code, sizeof(hl_code), "%c[%dm", editor_key::ESCAPE, hl);
-    hl_code[len] = 0;
-    buf.append(hl_code);
-}
+    auto it = hl.upper_bound(from);
+    for (auto j = from; j < to;) {
+        auto next_overlay = to;
+        const hl_span* over = nullptr;
+        for (const auto& span : overlay) {
+            if (span.start <= j && j < span.end())
+                over = &span;
+            else if (span.start > j)
+                next_overlay = std::min<std::size_t>(next_overlay, span.start);
+        }
+        if (over) {
+            auto run_end = std::min(to, over->end());
+            emit(j, run_end, static_cast<int>(over->color));
+            j = run_end;
+            continue;
+        }
 
-void draw_rows(editor& ed, str& buf)
-{
-    using std::begin, std::end;
-    for (size_t i = 0; i < ed.screen_row(); ++i) {
-        if (auto row_idx = i + ed.rowoff(); row_idx < ed.rows().size()) {
-            const auto& row = ed.rows()[row_idx];
-            const auto& render = row.render();
-            auto start_index = std::min(ed.coloff(), render.size());
-            auto max_len = std::min(render.size() - start_index, ed.screen_col());
-
-            const auto& hl = row.hl();
-            int prev_color = colors::DEFAULT;
-            for (size_t j = 0; j < max_len; ++j) {
-                if (hl[start_index + j] != prev_color)
-                    pad_hl(hl[start_index + j], buf);
-                buf.push_back(render[start_index + j]);
-                prev_color = hl[start_index + j];
-            }
-            pad_hl(colors::DEFAULT, buf);
-        } else if (ed.rows().empty() && i == ed.screen_row() >> 1) {
-            print_welcome(ed, buf);
-        } else {
-            buf.push_back('~');
+        while (it != hl.end() && it->end() <= j)
+            ++it;
+        int color = colors::DEFAULT;
+        auto run_end = to;
+        if (it != hl.end() && it->start <= j) {
+            color = static_cast<int>(it->color);
+            run_end = it->end();
+        } else if (it != hl.end()) {
+            run_end = it->start;
         }
+        run_end = std::min({ run_end, to, next_overlay });
+        emit(j, run_end, color);
+        j = run_end;
+    }
+}
 
-        buf.append(esc_seq::CLEAR_LINE);
-        buf.append(NEW_LINE);
+// screen line `i` of the text area
+static void draw_row(editor& ed, std::size_t i, screen& scr)
+{
+    static auto overlay = std::vector<hl_span>();
+    if (auto row_idx = i + ed.rowoff(); row_idx < ed.rows().size()) {
+        auto view = ed.row_view(row_idx);
+        auto render = view.render;
+        auto start_index = std::min(ed.coloff(), render.size());
+        auto max_len = std::min(render.size() - start_index, ed.screen_col());
+
+        overlay.clear();
+        for (const auto& o : ed.overlays())
+            if (o.row == row_idx)
+                overlay.push_back(o.span);
+
+        for_each_color_run(view.hl(), overlay, start_index, start_index + max_len,
+                [&](std::size_t from, std::size_t to, int color) {
+                    scr.put(i, from - start_index, render.substr(from, to - from), color);
+                });
+    } else if (ed.rows().empty() && i == ed.screen_row() >> 1) {
+        print_welcome(ed, i, scr);
+    } else {
+        scr.put(i, 0, "~");
     }
 }
 
-void reset_cursor_pos(editor& ed, str& buf)
+void draw_rows(editor& ed, screen& scr)
 {
-    buf.append(std::format("\x1b[{:d};{:d}H",
-                (ed.c_row() - ed.rowoff() + 1),
-                (ed.r_col() - ed.coloff() + 1)).c_str());
+    for (size_t i = 0; i < ed.screen_row(); ++i)
+        draw_row(ed, i, scr);
 }
 
 void scroll(editor& ed)
@@ -139,18 +168,47 @@ void scroll(editor& ed)
         coloff = r_col - screen_col + 1;
 }
 
-void refresh_screen(editor& ed)
+void compose_frame(editor& ed, frame& f)
 {
     scroll(ed);
 
-    auto buf = str();
-    buf.append(esc_seq::HIDE_CURSOR);
-    buf.append(esc_seq::CLEAR_CURSOR_POS);
-    draw_rows(ed, buf);
-    draw_statusbar(ed, buf);
-    draw_status_msg_bar(ed, buf);
-    reset_cursor_pos(ed, buf);
-    buf.append(esc_seq::SHOW_CURSOR);
+    auto& cells = f.cells;
+    if (cells.rows() != ed.screen_row() + 2 || cells.cols() != ed.screen_col())
+        cells.resize(ed.screen_row() + 2, ed.screen_col());
+    else
+        cells.clear();
+    draw_rows(ed, cells);
+    draw_statusbar(ed, cells);
+    draw_status_msg_bar(ed, cells);
+
+    f.cursor = { ed.c_row() - ed.rowoff(), ed.r_col() - ed.coloff() };
+    f.offset = { ed.rowoff(), ed.coloff() };
+    f.text_rows = ed.screen_row();
+}
+
+const str& draw_frame(editor& ed)
+{
+    // the frame is drawn into and what the terminal shows, reused so that a
+    // steady frame allocates nothing
+    static auto next = frame();
+    static auto writer = frame_writer();
+
+    compose_frame(ed, next);
+    return writer.update(next);
+}
+
+bool refresh_screen(editor& ed)
+{
+    if (!renderer.running()) {
+        if (const auto& out = draw_frame(ed); !out.empty())
+            write(STDOUT_FILENO, out.c_str(), out.size());
+        return true;
+    }
 
-    write(STDOUT_FILENO, buf.c_str(), buf.size());
+    auto* f = renderer.acquire();
+    if (!f)
+        return false;
+    compose_frame(ed, *f);
+    renderer.submit(f);
+    return true;
 }
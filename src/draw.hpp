@@ -1,5 +1,17 @@
 #pragma once
 
 #include "editor.hpp"
+#include "screen.hpp"
 
-void refresh_screen(editor&);
+void draw_rows(editor&, screen&);
+
+// draws the editor as it is into `f`
+void compose_frame(editor&, frame& f);
+
+// draws the next frame and returns what brings the terminal up to date with
+// it, nothing when it already is; valid until the next call
+const str& draw_frame(editor&);
+
+// draws the next frame and hands it to the renderer once it runs, writes it
+// right away before; false when every frame is still waiting to be written
+bool refresh_screen(editor&);
@@ -1,167 +1,221 @@
 #include "str.hpp"
 #include "editor.hpp"
+#include "command.hpp"
 #include "editor_keys.hpp"
+#include "event_loop.hpp"
 #include "read_input.hpp"
+#include "render_thread.hpp"
+#include "task_pool.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <format>
+#include <iterator>
+#include <optional>
 #include <stdexcept>
 #include <sys/ioctl.h>
 #include <unistd.h>
 
 using namespace char_seq;
 
-editor_row::editor_row(const str& s, std::optional<editor_syntax> hl_syntax)
+namespace
+{
+    // moves the tabs from `from` on by `offset` bytes and `cols` columns
+    void shift_tabs(std::vector<tab_stop>::iterator from, std::vector<tab_stop>::iterator to,
+            int offset, int cols)
+    {
+        for (; from != to; ++from) {
+            from->offset = static_cast<std::uint32_t>(static_cast<int>(from->offset) + offset);
+            from->end = static_cast<std::uint32_t>(static_cast<int>(from->end) + cols);
+        }
+    }
+
+    std::vector<tab_stop>::iterator first_tab_from(std::vector<tab_stop>& tabs, std::size_t idx)
+    {
+        return std::lower_bound(tabs.begin(), tabs.end(), idx,
+                [](const tab_stop& tab, std::size_t i) { return tab.offset < i; });
+    }
+}
+
+editor_row::editor_row()
+{ upd_row(); }
+
+editor_row::editor_row(const str& s, const editor_syntax* hl_syntax, hl_state entry)
     : m_content{s}
     , m_hl_syntax{hl_syntax}
+    , m_entry{entry}
 { upd_row(); }
 
-editor_row::editor_row(str&& s, std::optional<editor_syntax> hl_syntax)
-    : m_content{s}
+editor_row::editor_row(str&& s, const editor_syntax* hl_syntax, hl_state entry)
+    : m_content{std::move(s)}
     , m_hl_syntax{hl_syntax}
+    , m_entry{entry}
 { upd_row(); }
 
-void editor_row::upd_row()
+void editor_row::borrow(std::string_view line)
 {
-    render_content();
-    hl_content();
+    m_content.clear();
+    m_span = line;
+    upd_row();
 }
 
-void editor_row::render_content()
+void editor_row::own()
 {
-    using std::begin, std::end;
-    auto tab_cnt = std::count(begin(m_content), end(m_content), '\t');
+    if (!m_span.data())
+        return;
+    m_content = str(m_span.data(), m_span.data() + m_span.size());
+    m_span = {};
+}
 
-    m_render.clear();
-    m_render.reserve(m_content.size() + static_cast<size_t>(tab_cnt * (TABSTOP - 1)) + 1);
+render_view editor_row::view() const
+{
+    if (m_local)
+        return { m_local, m_local->render(m_content) };
+    auto shared = render_cache.get(text(), m_hash, m_hl_syntax, m_entry);
+    auto render = shared->render(text());
+    return { std::move(shared), render };
+}
 
-    size_t idx = 0;
-    for (auto c : m_content) {
-        if (c == '\t') {
-            auto cnt = TABSTOP - idx % TABSTOP;
-            m_render.append(cnt, ' ');
-            idx += cnt - 1;
-        } else {
-            m_render.push_back(c);
-        }
-        ++idx;
-    }
+void editor_row::upd_row()
+{
+    m_local.reset();
+    auto t = text();
+    m_hash = hash_content(t.data(), t.size());
 }
 
-void editor_row::hl_content()
+void editor_row::settle()
 {
-    m_hl.resize(m_render.size(), colors::DEFAULT);
-    if (!m_hl_syntax.has_value())
+    if (!m_local)
         return;
+    m_hash = hash_content(m_content.c_str(), m_content.size());
+    render_cache.put(m_content, m_hash, m_hl_syntax, m_entry, std::move(m_local));
+    m_local.reset();
+}
 
-    static char in_string = 0;
-    static char in_comment = 0;
-    bool prev_is_sep = true;
-    for (size_t i = 0; i < m_render.size(); ++i) {
-        static auto is_sep = [](char c) {
-            return isspace(c)
-                || c == '\0'
-                || str(",.()+-/*=~%<>[];'\"").find(c) != str::npos;
-        };
-        auto cur_color = colors::DEFAULT;
-        auto prev_color = (i) ? m_hl[i - 1] : colors::DEFAULT;
-        auto hl_nums = [&](char c) {
-            return (m_hl_syntax.has_value() &&
-                    (m_hl_syntax.value().flags & HL_NUMBER) &&
-                    std::isdigit(c)
-                    && (prev_is_sep || prev_color == colors::CYAN))
-                || (c == '.' && prev_color == colors::CYAN);
+bool editor_row::set_entry_state(hl_state entry)
+{
+    if (entry == m_entry)
+        return false;
+    settle();
+    m_entry = entry;
+    return true;
+}
 
-        };
-        auto hl_string = [&](char c) {
-            if (!(m_hl_syntax.value().flags & HL_STRING))
-                return false;
-            if (in_string) {
-                if (c == in_string && i && m_render[i - 1] != '\\')
-                    in_string = 0;
-                return true;
-            } else if (c == '"' || c == '\'') {
-                in_string = c;
-                return true;
-            }
-            return false;
-        };
-        auto hl_single_comment = [&]() {
-            const auto& cmt_syntax = m_hl_syntax->single_line_comment_syntax;
-            return !in_comment && !m_render.compare(i, cmt_syntax.size(), cmt_syntax);
-        };
-        auto hl_multi_comment = [&]() {
-            const auto& comment_begin = m_hl_syntax->multi_line_comment_begin;
-            const auto& comment_end = m_hl_syntax->multi_line_comment_end;
-            if (in_comment) {
-                if (!comment_end.compare(0, comment_end.size(), m_render, i, comment_end.size())) {
-                    m_hl.replace(i, comment_end.size(), comment_end.size(), colors::WHITE);
-                    i += comment_end.size() - 1;
-                    in_comment = 0;
-                }
-                return true;
-            } else if (!comment_begin.compare(0, comment_begin.size(),
-                        m_render, i, comment_begin.size())) {
-                m_hl.replace(i, comment_begin.size(), comment_begin.size(), colors::WHITE);
-                i += comment_begin.size() - 1;
-                in_comment = true;
-                return true;
-            }
-            return false;
-        };
-        auto hl_keyword = [&]() {
-            if (!prev_is_sep)
-                return false;
-
-            for (const auto& keyword : m_hl_syntax->keywords) {
-                if (!keyword.compare(0, keyword.size(), m_render, i, keyword.size())
-                        && is_sep(m_render[i + keyword.size()])) {
-                    m_hl.replace(i, keyword.size(), keyword.size(), colors::RED);
-                    i += keyword.size();
-                    return true;
-                }
-            }
-            return false;
-        };
+row_render& editor_row::detach()
+{
+    own();
+    if (!m_local)
+        m_local = std::make_shared<row_render>(
+                *render_cache.get(m_content, m_hash, m_hl_syntax, m_entry));
+    return *m_local;
+}
 
-        if (hl_single_comment()) {
-            m_hl.replace(i, m_hl.size() - i, m_hl.size() - i, colors::WHITE);
-            break;
-        } else if (hl_multi_comment()) {
-            cur_color = colors::WHITE;
-        } else if (hl_keyword()) {
-            prev_is_sep = false;
-        } else if (hl_string(m_render[i])) {
-            cur_color = colors::YELLOW;
-        } else if (hl_nums(m_render[i])) {
-            cur_color = colors::CYAN;
+// keeps the render and highlighting in step with inserting `c` before
+// `index`; a tab moves everything behind it and is left to upd_row()
+bool editor_row::patch_insert(str::size_type index, int c)
+{
+    if (c == '\t')
+        return false;
+
+    auto& local = detach();
+    auto col = local.render_col(index);
+    m_content.insert(index, 1, c);
+
+    auto edit = hl_edit{ col, 0, 1 };
+    if (local.has_tabs()) {
+        local.expanded.insert(col, 1, c);
+        // the next tab absorbs the shift, unless it was a single column
+        // wide and now fills a whole tab stop
+        if (auto tab = first_tab_from(local.tabs, index); tab != local.tabs.end()) {
+            auto tab_col = local.render_col(tab->offset);
+            auto width = tab->end - tab_col;
+            auto cols = 0;
+            if (width > 1) {
+                local.expanded.erase(tab_col + 1, 1);
+                edit.removed = edit.added = tab_col + width - col;
+            } else {
+                local.expanded.insert(tab_col + 2, TABSTOP - 1, ' ');
+                edit.removed = tab_col + 1 - col;
+                edit.added = edit.removed + TABSTOP;
+                cols = TABSTOP;
+            }
+            shift_tabs(tab, local.tabs.end(), 1, cols);
         }
-        m_hl[i] = static_cast<char>(cur_color);
+    }
+    if (m_hl_syntax)
+        m_hl_syntax->rehighlight(*m_hl_syntax, local.render(m_content), local.hl,
+                m_entry, local.exit_state, edit);
+    return true;
+}
 
-        prev_is_sep = is_sep(m_render[i]);
-        prev_color = cur_color;
+// the counterpart of patch_insert() for erasing the character at `index`
+bool editor_row::patch_erase(str::size_type index)
+{
+    if (text()[index] == '\t')
+        return false;
+
+    auto& local = detach();
+    auto col = local.render_col(index);
+    m_content.erase(index, 1);
+
+    auto edit = hl_edit{ col, 1, 0 };
+    if (local.has_tabs()) {
+        local.expanded.erase(col, 1);
+        // the next tab grows by a column, one filling a whole tab stop
+        // shrinks to a single column instead
+        if (auto tab = first_tab_from(local.tabs, index); tab != local.tabs.end()) {
+            auto tab_col = local.render_col(tab->offset);
+            auto width = tab->end - tab_col;
+            auto cols = 0;
+            if (width < TABSTOP) {
+                local.expanded.insert(tab_col - 1, 1, ' ');
+                edit.removed = edit.added = tab_col + width - col;
+            } else {
+                local.expanded.erase(tab_col, TABSTOP - 1);
+                edit.removed = tab_col + TABSTOP - col;
+                edit.added = edit.removed - TABSTOP;
+                cols = -TABSTOP;
+            }
+            shift_tabs(tab, local.tabs.end(), -1, cols);
+        }
     }
+    if (m_hl_syntax)
+        m_hl_syntax->rehighlight(*m_hl_syntax, local.render(m_content), local.hl,
+                m_entry, local.exit_state, edit);
+    return true;
 }
 
 void editor_row::insert(str::size_type index, str::size_type count, int c)
 {
-    m_content.insert(index, count, c);
+    if (count == 1 && patch_insert(index, c))
+        return;
+    content().insert(index, count, c);
     upd_row();
 }
 
 void editor_row::erase(str::size_type index, str::size_type count)
 {
-    m_content.erase(index, count);
+    if (count == 1 && index < size() && patch_erase(index))
+        return;
+    content().erase(index, count);
     upd_row();
 }
 
 void editor_row::append(const editor_row& row)
 {
-    m_content.append(row.content());
+    auto t = row.text();
+    content().append(t.data(), t.size());
     upd_row();
 }
 
 
 editor::editor()
+{
+    update_screen_size();
+}
+
+void editor::update_screen_size()
 {
     winsize ws;
     if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == -1 || ws.ws_row == 0)
@@ -170,30 +224,84 @@ editor::editor()
     m_screen_col = ws.ws_col;
 }
 
+editor::editor(std::size_t screen_row, std::size_t screen_col)
+    : m_screen_row{screen_row}
+    , m_screen_col{screen_col}
+{ }
+
 void editor::set_ft()
 {
     if (m_filename.empty())
         return;
 
     auto file_ext_idx = m_filename.rfind('.');
+    if (file_ext_idx == str::npos)
+        return;
+
+    auto file_ext = std::string_view(m_filename.c_str() + file_ext_idx);
     for (const auto& hl_syntax : HLDB) {
         for (const auto& ft : hl_syntax.filematches) {
-            auto filetype_matches = [&]() {
-                return !ft.compare(0, ft.size(), m_filename,
-                        file_ext_idx, m_filename.size() - file_ext_idx);
-            };
-            if (filetype_matches()) {
-                m_hl_syntax = hl_syntax;
-                for (auto& row : m_rows) {
+            if (ft == file_ext) {
+                settle_hot();
+                m_hl_syntax = &hl_syntax;
+                for (auto& row : m_rows)
                     row.hl_syntax() = m_hl_syntax;
-                    row.upd_row();
-                }
+                m_hl_valid = 0;
                 return;
             }
         }
     }
 }
 
+render_view editor::row_view(std::size_t idx)
+{
+    sync_hl(idx);
+    return m_rows[idx].view();
+}
+
+// fixes the entry state of the rows from `idx` on until one already starts
+// where its predecessor ends, e.g. after an edit opened or closed a comment.
+// rows past m_hl_valid are left to sync_hl()
+void editor::propagate_hl(std::size_t idx)
+{
+    for (; idx && idx < m_hl_valid; ++idx)
+        if (!m_rows[idx].set_entry_state(m_rows[idx - 1].view().exit_state()))
+            break;
+}
+
+bool editor::index_hl(std::size_t count)
+{
+    if (hl_pending() && count)
+        sync_hl(std::min(m_hl_valid + count, m_rows.size()) - 1);
+    return hl_pending();
+}
+
+// chains the entry states down to row `idx`; every row above it gets
+// highlighted once, later calls only pay for rows not seen before
+void editor::sync_hl(std::size_t idx)
+{
+    if (!m_hl_valid && !m_rows.empty()) {
+        m_rows.front().set_entry_state({});
+        m_hl_valid = 1;
+    }
+    for (; m_hl_valid <= idx && m_hl_valid < m_rows.size(); ++m_hl_valid)
+        m_rows[m_hl_valid].set_entry_state(m_rows[m_hl_valid - 1].view().exit_state());
+}
+
+// the row typed in last keeps its own render only until typing moves on
+// to row `next`
+void editor::settle_hot(std::size_t next)
+{
+    if (m_hot_row != next && m_hot_row < m_rows.size())
+        m_rows[m_hot_row].settle();
+    m_hot_row = next;
+}
+
+hl_state editor::state_before(std::size_t idx)
+{
+    return idx ? row_view(idx - 1).exit_state() : hl_state{};
+}
+
 void editor::move_curor(int c)
 {
     switch (c) {
@@ -229,21 +337,19 @@ void editor::move_curor(int c)
 
 void editor::set_r_col()
 {
-    m_r_col = 0;
-    const auto& row = m_rows[m_c_row];
-    for (size_t i = 0; i < m_c_col; ++i) {
-        if (row.content()[i] == '\t')
-            m_r_col += (TABSTOP - 1) - (m_r_col % TABSTOP);
-        ++m_r_col;
-    }
+    m_r_col = row_view(m_c_row).render_col(m_c_col);
 }
 
 void editor::insert_char(int c)
 {
-    if (m_c_row == m_rows.size())
-        m_rows.push_back(str());
+    if (m_c_row == m_rows.size()) {
+        m_rows.emplace_back(str(), m_hl_syntax, state_before(m_c_row));
+        ++m_hl_valid;
+    }
 
+    settle_hot(m_c_row);
     m_rows[m_c_row].insert(m_c_col++, 1, c);
+    propagate_hl(m_c_row + 1);
     ++m_dirty;
 }
 
@@ -254,35 +360,174 @@ void editor::delete_char()
 
     auto& current_row = m_rows[m_c_row];
     if (m_c_col) {
+        settle_hot(m_c_row);
         current_row.erase(m_c_col - 1, 1);
+        propagate_hl(m_c_row + 1);
         --m_c_col;
         ++m_dirty;
     } else if (m_c_row) {
+        settle_hot();
         auto& prev_row = m_rows[m_c_row - 1];
-        m_c_col = prev_row.content().size();
+        m_c_col = prev_row.size();
         prev_row.append(current_row);
         m_rows.erase(begin(m_rows) + static_cast<long>(m_c_row));
+        if (m_c_row < m_hl_valid)
+            --m_hl_valid;
         --m_c_row;
+        propagate_hl(m_c_row + 1);
         ++m_dirty;
     }
 }
 
 void editor::insert_newline()
 {
+    settle_hot();
     auto c_row_iter = begin(m_rows) + static_cast<ptrdiff_t>(m_c_row);
     if (!m_c_col) {
-        m_rows.emplace(c_row_iter, str());
+        // an empty row ends in the state it starts in, nothing below changes
+        auto entry = state_before(m_c_row);
+        m_rows.emplace(begin(m_rows) + static_cast<ptrdiff_t>(m_c_row), str(), m_hl_syntax, entry);
+        // state_before() synced every row above, the new one starts right too
+        ++m_hl_valid;
     } else {
         auto new_row = str(c_row_iter->content().begin() + m_c_col, c_row_iter->content().end());
         c_row_iter->content().erase(c_row_iter->content().begin() + m_c_col, c_row_iter->content().end());
         c_row_iter->upd_row();
-        m_rows.emplace(c_row_iter + 1, std::move(new_row));
+        auto entry = row_view(m_c_row).exit_state();
+        m_rows.emplace(begin(m_rows) + static_cast<ptrdiff_t>(m_c_row + 1),
+                std::move(new_row), m_hl_syntax, entry);
+        ++m_hl_valid;
+        propagate_hl(m_c_row + 2);
         m_c_col = 0;
     }
     ++m_c_row;
     ++m_dirty;
 }
 
+// splits `text` into lines once and builds the new rows in one pass, they
+// are moved in with a single shift of the rows below. Only the rows that
+// changed are highlighted again, and the rows below until one starts in
+// the state it did before, e.g. when the text opened a comment
+text_pos editor::insert_text(text_pos pos, const str& text)
+{
+    if (text.empty() || pos.row > m_rows.size())
+        return pos;
+
+    settle_hot();
+    if (pos.row == m_rows.size()) {
+        m_rows.emplace_back(str(), m_hl_syntax, state_before(pos.row));
+        ++m_hl_valid;
+    }
+    pos.col = std::min(pos.col, m_rows[pos.row].size());
+
+    const auto* p = text.c_str();
+    const auto* end = p + text.size();
+    auto next_eol = [&]() {
+        return std::find_if(p, end, [](char c) { return c == '\r' || c == '\n'; });
+    };
+
+    auto& first = m_rows[pos.row].content();
+    auto tail = str(first.begin() + pos.col, first.end());
+    first.erase(first.begin() + pos.col, first.end());
+    const auto* eol = next_eol();
+    first.append(p, static_cast<std::size_t>(eol - p));
+    auto after = text_pos{ pos.row, first.size() };
+
+    auto lines = std::vector<editor_row>();
+    while (eol != end) {
+        p = eol + 1;
+        if (*eol == '\r' && p != end && *p == '\n')
+            ++p;
+        eol = next_eol();
+        auto line = str();
+        line.append(p, static_cast<std::size_t>(eol - p));
+        after.col = line.size();
+        if (eol == end)
+            line.append(tail);
+        lines.emplace_back(std::move(line), m_hl_syntax);
+    }
+    if (lines.empty())
+        first.append(tail);
+    m_rows[pos.row].upd_row();
+    after.row += lines.size();
+
+    // one move of the rows below, the capacity is reserved once for all
+    // the new rows
+    m_rows.insert(begin(m_rows) + static_cast<ptrdiff_t>(pos.row + 1),
+            std::make_move_iterator(lines.begin()), std::make_move_iterator(lines.end()));
+    if (pos.row < m_hl_valid) {
+        m_hl_valid += lines.size();
+        for (auto row = pos.row + 1; row <= after.row; ++row)
+            m_rows[row].set_entry_state(m_rows[row - 1].view().exit_state());
+        propagate_hl(after.row + 1);
+    }
+
+    if (m_c_row == pos.row && m_c_col >= pos.col) {
+        m_c_col = after.col + (m_c_col - pos.col);
+        m_c_row = after.row;
+    } else if (m_c_row > pos.row) {
+        m_c_row += lines.size();
+    }
+    ++m_dirty;
+    return after;
+}
+
+void editor::erase_range(text_pos from, text_pos to)
+{
+    if (m_rows.empty())
+        return;
+    auto clamp = [&](text_pos& p) {
+        if (p.row >= m_rows.size())
+            p = { m_rows.size() - 1, m_rows.back().size() };
+        p.col = std::min(p.col, m_rows[p.row].size());
+    };
+    clamp(from);
+    clamp(to);
+    if (to <= from)
+        return;
+
+    auto& first = m_rows[from.row];
+    if (from.row == to.row) {
+        // a single character is patched like typing, the row stays hot
+        settle_hot(from.row);
+        first.erase(from.col, to.col - from.col);
+    } else {
+        settle_hot();
+        auto last = m_rows[to.row].text();
+        first.content().erase(first.content().begin() + from.col, first.content().end());
+        first.content().append(last.data() + to.col, last.size() - to.col);
+        first.upd_row();
+        m_rows.erase(begin(m_rows) + static_cast<ptrdiff_t>(from.row + 1),
+                begin(m_rows) + static_cast<ptrdiff_t>(to.row + 1));
+        if (m_hl_valid > to.row)
+            m_hl_valid -= to.row - from.row;
+        else
+            m_hl_valid = std::min(m_hl_valid, from.row + 1);
+    }
+    propagate_hl(from.row + 1);
+
+    auto cursor = text_pos{ m_c_row, m_c_col };
+    if (cursor > to)
+        cursor = cursor.row == to.row
+            ? text_pos{ from.row, from.col + (cursor.col - to.col) }
+            : text_pos{ cursor.row - (to.row - from.row), cursor.col };
+    else if (cursor > from)
+        cursor = from;
+    m_c_row = cursor.row;
+    m_c_col = cursor.col;
+    ++m_dirty;
+}
+
+// what a row reads like on screen, searched instead of its content; the
+// render of one with tabs goes to `scratch`
+static std::string_view search_render(std::string_view content, row_render& scratch)
+{
+    if (!has_tabs(content))
+        return content;
+    render_content(content, scratch.expanded, scratch.tabs);
+    return scratch.expanded;
+}
+
 void editor::incr_find(const str& query, int key)
 {
     enum class direction { FORWARD, BACKWARD };
@@ -290,11 +535,11 @@ void editor::incr_find(const str& query, int key)
     static size_t last_match_col = str::npos;
     static direction dir = direction::FORWARD;
 
-    static size_t cached_hl_row = str::npos;
-    if (cached_hl_row != str::npos) {
-        m_rows[cached_hl_row].upd_row();
-        cached_hl_row = str::npos;
-    }
+    m_overlays.clear();
+    // a search still running was for an older query or direction, one
+    // running after Enter goes on and moves the cursor once done
+    if (key != '\r')
+        command::cancel(false);
 
     if (m_rows.empty())
         return;
@@ -313,52 +558,113 @@ void editor::incr_find(const str& query, int key)
         dir = direction::FORWARD;
     }
 
+    // search the render without highlighting, rows scanned past are never
+    // drawn and would only push visible ones out of the render cache.
+    // matches are in render columns, the cursor goes to content columns
+    static auto scratch = row_render();
+    auto render_of = [this](std::size_t row) {
+        return search_render(m_rows[row].text(), scratch);
+    };
+    auto jump_to = [this, query](std::size_t row, std::size_t pos) {
+        m_c_row = last_match_row = row;
+        last_match_col = pos;
+        auto content = m_rows[row].text();
+        auto render = search_render(content, scratch);
+        m_c_col = render.data() == content.data() ? pos : scratch.content_col(pos);
+        mark_match(row, pos, query.size());
+    };
+
+    // the rest of the row one step on from the last match
     auto cur_row = last_match_row;
     auto cur_col = last_match_col;
-    do {
-        switch (dir) {
-            case direction::FORWARD:
-                cur_col += 1;
-                break;
-            case direction::BACKWARD:
-                cur_col -= 1;
-                break;
-        }
-        if (cur_col == m_rows[cur_row].size()) {
-            cur_row = (cur_row + 1) % m_rows.size();
-            cur_col = 0;
+    switch (dir) {
+        case direction::FORWARD:
+            cur_col += 1;
+            break;
+        case direction::BACKWARD:
+            cur_col -= 1;
+            break;
+    }
+    if (cur_col == render_of(cur_row).size()) {
+        cur_row = (cur_row + 1) % m_rows.size();
+        cur_col = 0;
+    }
+    if (cur_col == str::npos) {
+        cur_row = std::min(cur_row - 1, m_rows.size() - 1);
+        cur_col = 0;
+    }
+
+    auto forward = dir == direction::FORWARD;
+    if (auto render = render_of(cur_row); forward) {
+        if (auto pos = render.find(query, cur_col); pos != str::npos) {
+            jump_to(cur_row, pos);
+            return;
         }
-        if (cur_col == str::npos) {
-            cur_row = std::min(cur_row - 1, m_rows.size() - 1);
-            cur_col = 0;
+    } else {
+        if (auto pos = render.rfind(query, cur_col); pos != str::npos) {
+            jump_to(cur_row, pos);
+            return;
         }
+    }
 
-        auto& row = m_rows[cur_row];
-        if (dir == direction::FORWARD) {
-            if (auto pos = row.render().find(query, cur_col); pos != str::npos) {
-                m_c_row = last_match_row = cur_row;
-                m_c_col = last_match_col = pos;
-                row.hl().replace(pos, query.size(), query.size(), colors::RED);
-                cached_hl_row = cur_row;
-                return;
-            } else {
-                cur_row = (cur_row + 1) % m_rows.size();
-                cur_col = str::npos;
-            }
-        }
-        if (dir == direction::BACKWARD) {
-            if (auto pos = row.render().rfind(query, cur_col); pos != str::npos) {
-                m_c_row = last_match_row = cur_row;
-                m_c_col = last_match_col = pos;
-                row.hl().replace(pos, query.size(), query.size(), colors::RED);
-                cached_hl_row = cur_row;
-                return;
-            } else {
-                cur_row = std::min(cur_row - 1, m_rows.size() - 1);
-                cur_col = m_rows[cur_row].size();
+    // then whole rows in turn up to and including the last match's row, so
+    // a lone match is found again. They are searched in parallel, a range of
+    // rows past a match found already is skipped, the nearest match wins.
+    // More rows than a range make it a command, which may be cancelled
+    static constexpr std::size_t SEARCH_ROWS = 1 << 12;
+    auto n = m_rows.size();
+    auto count = 1 + (forward
+        ? (last_match_row + n - cur_row - 1) % n
+        : (cur_row + n - last_match_row - 1) % n);
+    auto row_at = [=](std::size_t k) {
+        return forward ? (cur_row + 1 + k) % n : (cur_row + n - 1 - k) % n;
+    };
+
+    // the nearest of the rows with a match, `count` when there is none
+    auto nearest = [this, query, count, row_at](command::progress* p) {
+        using std::begin, std::end;
+        const auto lps = gen_lps(begin(query), end(query));
+        auto found = std::atomic<std::size_t>(count);
+        auto searched = std::atomic<std::size_t>();
+        workers.parallel_for(0, count, SEARCH_ROWS, [&](std::size_t from, std::size_t to) {
+            thread_local auto expanded = row_render();
+            for (auto k = from; k < to && k < found.load(std::memory_order_relaxed); ++k) {
+                auto render = search_render(m_rows[row_at(k)].text(), expanded);
+                if (query.empty() || render.size() < query.size()
+                        || kmp(0, render.data(), render.data() + render.size(),
+                            begin(query), end(query), lps) == str::npos)
+                    continue;
+                auto seen = found.load(std::memory_order_relaxed);
+                while (k < seen && !found.compare_exchange_weak(seen, k, std::memory_order_relaxed))
+                    ;
+                break;
             }
-        }
-    } while (cur_row != last_match_row);
+            if (p)
+                p->report(searched.fetch_add(to - from, std::memory_order_relaxed) + to - from, count);
+        }, task_priority::INTERACTIVE, p ? p->token() : cancel_token());
+        return found.load(std::memory_order_relaxed);
+    };
+    auto jump_to_row = [=, this](std::size_t k) {
+        if (k == count)
+            return;
+        auto row = row_at(k);
+        auto render = search_render(m_rows[row].text(), scratch);
+        jump_to(row, forward ? render.find(query) : render.rfind(query, render.size()));
+    };
+
+    if (count <= SEARCH_ROWS) {
+        jump_to_row(nearest(nullptr));
+        return;
+    }
+    command::start(m_status_msg, "Searching", [=](command::progress& p) -> command::finish {
+        auto k = nearest(&p);
+        return [=]() { jump_to_row(k); };
+    });
+}
+
+void editor::mark_match(std::size_t row, std::size_t col, std::size_t len)
+{
+    m_overlays.push_back({ row, hl_span::make(col, std::min(len, hl_span::MAX_LEN), colors::RED) });
 }
 
 void editor::find()
@@ -367,25 +673,126 @@ void editor::find()
     auto cache_col = m_c_col;
     auto cache_rowoff = m_rowoff;
     auto cache_coloff = m_coloff;
-    auto callback = std::function<void(editor&, const str&, int)>
-        (&editor::incr_find);
 
-    auto query = prompt_input(*this, "Search: ", callback);
-    if (!query.empty())
+    prompt_input(*this, "Search: ", [=](editor& ed, const std::optional<str>& query) {
+        if (query && !query->empty())
+            return;
+
+        ed.m_c_row = cache_row;
+        ed.m_c_col = cache_col;
+        ed.m_rowoff = cache_rowoff;
+        ed.m_coloff = cache_coloff;
+        ed.m_status_msg.set_content("Search aborted");
+    }, &editor::incr_find);
+}
+
+void editor::replace()
+{
+    prompt_input(*this, "Replace: ", [this](editor&, const std::optional<str>& query) {
+        if (!query || query->empty()) {
+            m_status_msg.set_content("Replace aborted");
+            return;
+        }
+        prompt_input(*this, "With: ", [this, query = *query](editor&, const std::optional<str>& with) {
+            if (with)
+                replace_all(query, *with);
+            else
+                m_status_msg.set_content("Replace aborted");
+        });
+    });
+}
+
+void editor::replace_all(const str& query, const str& with)
+{
+    if (query.empty())
         return;
 
-    m_c_row = cache_row;
-    m_c_col = cache_col;
-    m_rowoff = cache_rowoff;
-    m_coloff = cache_coloff;
-    m_status_msg.set_content("Search aborted");
+    // the new content of every row with a match is made on the workers, a
+    // range of rows at a time, and put in place once all are done
+    using edits = std::vector<std::pair<std::size_t, str>>;
+    static constexpr std::size_t REPLACE_ROWS = 1 << 12;
+    command::start(m_status_msg, "Replacing", [this, query, with](command::progress& p) -> command::finish {
+        using std::begin, std::end;
+        const auto lps = gen_lps(begin(query), end(query));
+        auto ranges = std::vector<edits>((m_rows.size() + REPLACE_ROWS - 1) / REPLACE_ROWS);
+        auto matches = std::atomic<std::size_t>();
+        auto searched = std::atomic<std::size_t>();
+        workers.parallel_for(0, m_rows.size(), REPLACE_ROWS, [&](std::size_t from, std::size_t to) {
+            auto& range = ranges[from / REPLACE_ROWS];
+            for (auto i = from; i < to; ++i) {
+                auto content = m_rows[i].text();
+                auto next_match = [&](std::size_t pos) {
+                    if (content.size() - pos < query.size())
+                        return str::npos;
+                    return kmp(pos, content.data(), content.data() + content.size(),
+                            begin(query), end(query), lps);
+                };
+                auto pos = next_match(0);
+                if (pos == str::npos)
+                    continue;
+
+                auto replaced = str();
+                std::size_t last = 0;
+                for (; pos != str::npos; pos = next_match(last)) {
+                    replaced.append(content.data() + last, pos - last);
+                    replaced.append(with);
+                    last = pos + query.size();
+                    matches.fetch_add(1, std::memory_order_relaxed);
+                }
+                replaced.append(content.data() + last, content.size() - last);
+                range.emplace_back(i, std::move(replaced));
+            }
+            p.report(searched.fetch_add(to - from, std::memory_order_relaxed) + to - from, m_rows.size());
+        }, task_priority::INTERACTIVE, p.token());
+
+        return [this, ranges = std::move(ranges), count = matches.load()]() mutable {
+            for (auto& range : ranges)
+                for (auto& [row, content] : range)
+                    replace_row(row, std::move(content));
+            m_status_msg.set_content(std::format("{} occurrences replaced", count).c_str());
+        };
+    });
+}
+
+void editor::replace_row(std::size_t idx, str content)
+{
+    settle_hot();
+    m_overlays.clear();
+    auto& row = m_rows[idx];
+    row = editor_row(std::move(content), row.hl_syntax(), row.entry_state());
+    // the rows below may start in another state now
+    m_hl_valid = std::min(m_hl_valid, idx + 1);
+    if (m_c_row == idx)
+        m_c_col = std::min(m_c_col, m_rows[idx].size());
+    ++m_dirty;
+}
+
+void editor::set_rows(std::vector<editor_row> rows, std::shared_ptr<const void> text)
+{
+    // the old rows go before the text they may point into
+    m_rows = std::move(rows);
+    m_text = std::move(text);
+    m_hot_row = str::npos;
+    m_hl_valid = 0;
+    m_overlays.clear();
+    m_dirty = 0;
+    m_c_row = std::min(m_c_row, m_rows.size());
+    m_c_col = m_c_row < m_rows.size() ? std::min(m_c_col, m_rows[m_c_row].size()) : 0;
+}
+
+void editor::own_rows()
+{
+    for (auto& row : m_rows)
+        row.content();
+    m_text.reset();
 }
 
 str editor::rows_to_string() const
 {
     auto buf = str();
     for (const auto& line : m_rows) {
-        buf.append(line.content());
+        auto text = line.text();
+        buf.append(text.data(), text.size());
         buf.push_back('\n');
     }
 
@@ -394,6 +801,13 @@ str editor::rows_to_string() const
 
 void quit_editor()
 {
+    // a running command's work reports back to main_loop, it has to stop
+    // before the statics go
+    command::cancel(false);
+    while (command::running())
+        main_loop.run_once(std::chrono::milliseconds(-1));
+    // the last frame goes out before the screen is cleared
+    renderer.stop();
     write(STDOUT_FILENO, esc_seq::CLEAR_SCREEN, 4);
     write(STDOUT_FILENO, esc_seq::CLEAR_CURSOR_POS, 3);
     std::exit(0);
@@ -5,85 +5,54 @@
 #include <bitset>
 #include <algorithm>
 #include <cstddef>
+#include <memory>
 #include <utility>
 #include <vector>
 #include <chrono>
 
+#include "highlight.hpp"
+#include "row_cache.hpp"
+#include "status_message.hpp"
 #include "str.hpp"
 
-#define HL_NUMBER (1<<0)
-#define HL_STRING (1<<1)
-
-static constexpr unsigned short TABSTOP = 8;
 static constexpr unsigned short QUIT_TIMES = 1;
-static constexpr std::string_view DEFAULT_MSG = "HELP: CTRL-S = save"
-                                           " | CTRL-Q = Quit"
-                                           " | CTRL-F = Find";
-
-struct editor_syntax
-{
-    str filetype;
-    std::vector<str> filematches;
-    std::vector<str> keywords;
-    // TODO wrap comment with optional
-    str single_line_comment_syntax;
-    str multi_line_comment_begin;
-    str multi_line_comment_end;
-    unsigned int flags;
-};
-
-static const inline std::array HLDB{
-    editor_syntax{
-        "c",
-        {
-            ".c", ".cpp", ".h"
-        },
-        {
-            "switch", "if", "while", "for", "break", "continue", "return",
-            "else", "struct", "union", "typedef", "static", "enum", "class",
-            "case", "int", "long", "double", "float", "char", "unsigned",
-            "signed", "void",
-        },
-        "//", "/*", "*/",
-        HL_NUMBER | HL_STRING
-    },
-};
 
 class editor_row
 {
 public:
-    editor_row() = default;
+    editor_row();
 
-    editor_row(const str& s, std::optional<editor_syntax> hl_syntax = {});
+    editor_row(const str& s, const editor_syntax* hl_syntax = nullptr, hl_state entry = {});
 
-    editor_row(str&& s, std::optional<editor_syntax> hl_syntax = {});
+    editor_row(str&& s, const editor_syntax* hl_syntax = nullptr, hl_state entry = {});
 
-    const str& content() const
-    { return this->m_content; }
+    // shows `line` where it is, e.g. in a mapped file, in place of the
+    // content until the row is first edited; whoever holds the row keeps
+    // `line` alive until then
+    void borrow(std::string_view line);
 
-    str& content()
-    { return this->m_content; }
-
-    const str& render() const
-    { return this->m_render; }
-
-    str& render()
-    { return this->m_render; }
+    // the row's text, borrowed or its own
+    std::string_view text() const
+    { return this->m_span.data() ? this->m_span : this->m_content; }
 
-    const str& hl() const
-    { return this->m_hl; }
+    // the content to edit, a borrowed row copies its line first
+    str& content()
+    {
+        own();
+        return this->m_content;
+    }
 
-    str& hl()
-    { return this->m_hl; }
+    hl_state entry_state() const
+    { return this->m_entry; }
 
-    std::optional<editor_syntax>& hl_syntax()
+    const editor_syntax*& hl_syntax()
     { return this->m_hl_syntax; }
 
-    const std::optional<editor_syntax>& hl_syntax() const
+    const editor_syntax* hl_syntax() const
     { return this->m_hl_syntax; }
 
     str::size_type size() const
-    { return m_content.size(); }
+    { return text().size(); }
 
     void insert(str::size_type, str::size_type, int);
 
@@ -91,47 +60,52 @@ public:
 
     void append(const editor_row&);
 
+    // render and highlighting of the content, computed on demand and kept in
+    // render_cache; hold on to the handle only while using it
+    render_view view() const;
+
     void upd_row();
 
+    // hands a render patched by insert() or erase() back to render_cache
+    void settle();
+
+    // returns whether the row now starts in a different state
+    bool set_entry_state(hl_state);
+
 private:
     str m_content;
-    str m_render;
-    str m_hl;
-    std::optional<editor_syntax> m_hl_syntax;
+    // the line borrowed in place of m_content, while it points somewhere
+    std::string_view m_span{};
+    std::uint64_t m_hash{};
+    const editor_syntax* m_hl_syntax{};
+    hl_state m_entry{};
+    // render and highlighting owned by the row while it is being typed in,
+    // patched around every keystroke instead of redone; m_hash is stale
+    // while it is set
+    std::shared_ptr<row_render> m_local;
 
-    void render_content();
-    void hl_content();
-};
-
-class status_message
-{
-public:
-    status_message() = default;
+    void own();
 
-    status_message(str msg)
-    { set_content(std::move(msg)); }
+    row_render& detach();
 
-    const str& content() const
-    { return this->m_content; }
+    bool patch_insert(str::size_type, int);
 
-    const std::chrono::time_point<std::chrono::system_clock>& timestamp() const
-    { return this->m_timestamp; }
+    bool patch_erase(str::size_type);
+};
 
-    void set_content(str content)
-    {
-        this->m_content = std::move(content);
-        this->m_timestamp = std::chrono::system_clock::now();
-    }
+// a position in the text: a row and a byte offset in its content
+struct text_pos
+{
+    std::size_t row{}, col{};
 
-    void clear()
-    {
-        this->m_content.clear();
-        this->m_timestamp = std::chrono::system_clock::now();
-    }
+    auto operator<=>(const text_pos&) const = default;
+};
 
-private:
-    str m_content = DEFAULT_MSG.data();
-    std::chrono::time_point<std::chrono::system_clock> m_timestamp = std::chrono::system_clock::now(); // wtf man..., i just want to get the time
+// highlighting drawn on top of a row's own runs, e.g. a search match
+struct hl_overlay
+{
+    std::size_t row;
+    hl_span span;
 };
 
 class editor
@@ -139,6 +113,8 @@ class editor
 public:
     editor();
 
+    editor(std::size_t screen_row, std::size_t screen_col);
+
     str& filename()
     { return this->m_filename; }
 
@@ -205,14 +181,37 @@ public:
     const status_message& status_msg() const
     { return this->m_status_msg; }
 
-    std::optional<editor_syntax>& hl_syntax()
+    std::vector<hl_overlay>& overlays()
+    { return this->m_overlays; }
+
+    const std::vector<hl_overlay>& overlays() const
+    { return this->m_overlays; }
+
+    const editor_syntax*& hl_syntax()
     { return this->m_hl_syntax; }
 
-    const std::optional<editor_syntax>& hl_syntax() const
+    const editor_syntax* hl_syntax() const
     { return this->m_hl_syntax; }
 
     void set_ft();
 
+    // takes the size of the terminal again, as after SIGWINCH
+    void update_screen_size();
+
+    // render and highlighting of row `idx`, bringing the entry states of the
+    // rows above up to date first
+    render_view row_view(std::size_t idx);
+
+    void propagate_hl(std::size_t);
+
+    // highlights up to `count` rows past those already chained, as idle
+    // work ahead of a jump down the file; returns whether rows are left
+    bool index_hl(std::size_t count);
+
+    // whether some rows were not highlighted yet
+    bool hl_pending() const
+    { return this->m_hl_syntax && this->m_hl_valid < this->m_rows.size(); }
+
     void move_curor(int);
 
     void set_r_col();
@@ -223,8 +222,42 @@ public:
 
     void insert_newline();
 
+    // inserts `text` at `pos`, a CR, LF or CR LF in it ends a line; returns
+    // the position behind it. A cursor at or behind `pos` moves along
+    text_pos insert_text(text_pos pos, const str& text);
+
+    // erases the text from `from` up to `to`, joining their rows. A cursor
+    // behind `from` moves along, one in between goes to `from`
+    void erase_range(text_pos from, text_pos to);
+
+    // inserts `text` at the cursor, leaving the cursor behind it
+    void paste(const str& text)
+    { insert_text({ m_c_row, m_c_col }, text); }
+
     void find();
 
+    // the search prompt's callback, moves to the next match of `query` in
+    // the direction `key` asks for. A search through many rows runs as a
+    // command and moves the cursor once done
+    void incr_find(const str& query, int key);
+
+    // asks what to replace with what
+    void replace();
+
+    // replaces every `query` in the text with `with`, as a command
+    void replace_all(const str& query, const str& with);
+
+    // takes `content` as row `idx`'s
+    void replace_row(std::size_t idx, str content);
+
+    // takes `rows` as the whole text, as after loading it again. `text` is
+    // what rows borrowed from, kept as long as the rows are
+    void set_rows(std::vector<editor_row> rows, std::shared_ptr<const void> text = {});
+
+    // copies the lines rows borrowed into the rows, and lets go of what
+    // they were borrowed from
+    void own_rows();
+
     str rows_to_string() const;
 
 private:
@@ -235,10 +268,24 @@ private:
     std::size_t m_c_row{}, m_c_col{}, m_r_col{};
     std::size_t m_rowoff{}, m_coloff{};
     std::vector<editor_row> m_rows;
+    // the loaded file the rows were borrowed from
+    std::shared_ptr<const void> m_text;
     status_message m_status_msg;
-    std::optional<editor_syntax> m_hl_syntax;
+    std::vector<hl_overlay> m_overlays;
+    const editor_syntax* m_hl_syntax{};
+    // rows before this one start in the state their predecessor ends in,
+    // the others are only highlighted once they are looked at
+    std::size_t m_hl_valid{};
+    // the row typed in last, the only one owning its render
+    std::size_t m_hot_row = str::npos;
+
+    void sync_hl(std::size_t);
+
+    void settle_hot(std::size_t next = str::npos);
+
+    void mark_match(std::size_t, std::size_t, std::size_t);
 
-    void incr_find(const str&, int);
+    hl_state state_before(std::size_t);
 };
 
 void quit_editor();
@@ -19,6 +19,9 @@ namespace char_seq
         static constexpr const char* SHOW_CURSOR = "\x1b[?25h";
         static constexpr const char* INVERT_COLOR = "\x1b[7m";
         static constexpr const char* RESET_COLOR = "\x1b[m";
+        // pasted text comes between ESC[200~ and ESC[201~
+        static constexpr const char* ENABLE_PASTE = "\x1b[?2004h";
+        static constexpr const char* DISABLE_PASTE = "\x1b[?2004l";
     }
 
 }
@@ -35,6 +38,21 @@ enum editor_key : int
     HOME,
     END,
     DEL,
+    INSERT,
+    F1,
+    F2,
+    F3,
+    F4,
+    F5,
+    F6,
+    F7,
+    F8,
+    F9,
+    F10,
+    F11,
+    F12,
+    // a bracketed paste, its text is taken from the key_decoder
+    PASTE,
     ESCAPE = '\x1b',
 };
 
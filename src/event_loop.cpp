@@ -0,0 +1,164 @@
+#include "event_loop.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+event_loop main_loop;
+
+event_loop::event_loop()
+    : m_epoll{epoll_create1(EPOLL_CLOEXEC)}
+    , m_wake{eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)}
+{
+    if (m_epoll == -1 || m_wake == -1)
+        throw std::runtime_error("event loop error");
+
+    auto ev = epoll_event{};
+    ev.events = EPOLLIN;
+    ev.data.fd = m_wake;
+    if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &ev) == -1)
+        throw std::runtime_error("event loop error");
+}
+
+event_loop::~event_loop()
+{
+    close(m_wake);
+    close(m_epoll);
+}
+
+void event_loop::watch(int fd, handler on_ready)
+{
+    auto ev = epoll_event{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    auto op = m_handlers.contains(fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    if (epoll_ctl(m_epoll, op, fd, &ev) == -1)
+        throw std::runtime_error("epoll_ctl error");
+    m_handlers[fd] = std::move(on_ready);
+}
+
+void event_loop::unwatch(int fd)
+{
+    if (m_handlers.erase(fd))
+        epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+}
+
+void event_loop::post(handler fn)
+{
+    {
+        auto lock = std::lock_guard(m_posted_mutex);
+        m_posted.push_back(std::move(fn));
+    }
+    std::uint64_t one = 1;
+    write(m_wake, &one, sizeof(one));
+}
+
+std::size_t event_loop::run_posted()
+{
+    std::uint64_t count;
+    read(m_wake, &count, sizeof(count));
+
+    auto batch = std::vector<handler>();
+    {
+        auto lock = std::lock_guard(m_posted_mutex);
+        batch.swap(m_posted);
+    }
+    for (auto& fn : batch)
+        fn();
+    return batch.size();
+}
+
+std::size_t event_loop::run_once(std::chrono::milliseconds timeout)
+{
+    epoll_event events[16];
+    auto n = epoll_wait(m_epoll, events, 16, timeout.count() < 0 ? -1 : static_cast<int>(timeout.count()));
+    if (n == -1) {
+        if (errno == EINTR)
+            return 0;
+        throw std::runtime_error("epoll_wait error");
+    }
+
+    std::size_t ran = 0;
+    for (int i = 0; i < n; ++i) {
+        auto fd = events[i].data.fd;
+        if (fd == m_wake) {
+            ran += run_posted();
+            continue;
+        }
+        // a handler may unwatch fds, look each one up again
+        if (auto it = m_handlers.find(fd); it != m_handlers.end()) {
+            auto on_ready = it->second;
+            on_ready();
+            ++ran;
+        }
+    }
+    return ran;
+}
+
+timer_fd::timer_fd()
+    : m_fd{timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)}
+{
+    if (m_fd == -1)
+        throw std::runtime_error("timerfd error");
+}
+
+timer_fd::~timer_fd()
+{ close(m_fd); }
+
+void timer_fd::arm(std::chrono::nanoseconds after)
+{
+    using std::chrono::seconds, std::chrono::duration_cast;
+
+    // a zero expiry would disarm the timer instead
+    after = std::max(after, std::chrono::nanoseconds(1));
+    auto spec = itimerspec{};
+    auto secs = duration_cast<seconds>(after);
+    spec.it_value.tv_sec = secs.count();
+    spec.it_value.tv_nsec = (after - secs).count();
+    if (timerfd_settime(m_fd, 0, &spec, nullptr) == -1)
+        throw std::runtime_error("timerfd error");
+}
+
+void timer_fd::disarm()
+{
+    auto spec = itimerspec{};
+    timerfd_settime(m_fd, 0, &spec, nullptr);
+}
+
+std::uint64_t timer_fd::consume()
+{
+    std::uint64_t expired = 0;
+    if (read(m_fd, &expired, sizeof(expired)) != sizeof(expired))
+        return 0;
+    return expired;
+}
+
+signal_fd::signal_fd(std::initializer_list<int> signals)
+{
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (auto sig : signals)
+        sigaddset(&mask, sig);
+    if (sigprocmask(SIG_BLOCK, &mask, nullptr) == -1)
+        throw std::runtime_error("sigprocmask error");
+    m_fd = signalfd(-1, &mask, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (m_fd == -1)
+        throw std::runtime_error("signalfd error");
+}
+
+signal_fd::~signal_fd()
+{ close(m_fd); }
+
+int signal_fd::consume()
+{
+    auto info = signalfd_siginfo{};
+    if (read(m_fd, &info, sizeof(info)) != sizeof(info))
+        return 0;
+    return static_cast<int>(info.ssi_signo);
+}
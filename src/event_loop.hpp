@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// waits on any number of file descriptors with epoll and runs the handler of
+// those that became readable. Other threads hand work to the loop's thread
+// with post(), which wakes it through an eventfd
+class event_loop
+{
+public:
+    using handler = std::function<void()>;
+
+    event_loop();
+
+    ~event_loop();
+
+    event_loop(const event_loop&) = delete;
+    event_loop& operator=(const event_loop&) = delete;
+
+    // runs `on_ready` whenever `fd` is readable, until unwatch(fd)
+    void watch(int fd, handler on_ready);
+
+    void unwatch(int fd);
+
+    // runs `fn` on the loop's thread, callable from any thread
+    void post(handler fn);
+
+    // waits up to `timeout`, forever when negative, and runs the handlers
+    // of what is ready; returns how many ran
+    std::size_t run_once(std::chrono::milliseconds timeout);
+
+private:
+    int m_epoll{-1};
+    int m_wake{-1};
+    std::unordered_map<int, handler> m_handlers;
+
+    std::mutex m_posted_mutex;
+    std::vector<handler> m_posted;
+
+    std::size_t run_posted();
+};
+
+// a monotonic timerfd, readable once an armed timer expired
+class timer_fd
+{
+public:
+    timer_fd();
+
+    ~timer_fd();
+
+    timer_fd(const timer_fd&) = delete;
+    timer_fd& operator=(const timer_fd&) = delete;
+
+    int fd() const
+    { return this->m_fd; }
+
+    // expires once `after` from now, replacing an earlier arm()
+    void arm(std::chrono::nanoseconds after);
+
+    void disarm();
+
+    // acknowledges an expiry, returns how many happened since the last one
+    std::uint64_t consume();
+
+private:
+    int m_fd{-1};
+};
+
+// a signalfd for `signals`, which are blocked for normal delivery; create it
+// before starting threads so that they inherit the mask
+class signal_fd
+{
+public:
+    explicit signal_fd(std::initializer_list<int> signals);
+
+    ~signal_fd();
+
+    signal_fd(const signal_fd&) = delete;
+    signal_fd& operator=(const signal_fd&) = delete;
+
+    int fd() const
+    { return this->m_fd; }
+
+    // the next pending signal, 0 when none is
+    int consume();
+
+private:
+    int m_fd{-1};
+};
+
+extern event_loop main_loop;
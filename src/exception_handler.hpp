@@ -3,6 +3,7 @@
 #include <exception>
 #include <unistd.h>
 
+#include "render_thread.hpp"
 #include "termios_raii.hpp"
 #include "editor_keys.hpp"
 
@@ -10,6 +11,7 @@ using namespace char_seq;
 
 [[noreturn]] static inline void exception_handler()
 {
+    renderer.stop();
     t_ios.disable_raw_mode();
     write(STDOUT_FILENO, esc_seq::CLEAR_SCREEN, 4);
     write(STDOUT_FILENO, esc_seq::CLEAR_CURSOR_POS, 3);
@@ -1,51 +1,388 @@
+#include <array>
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
 #include <format>
 #include <iomanip>
+#include <optional>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "file_io.hpp"
 #include "editor.hpp"
 #include "read_input.hpp"
+#include "task_pool.hpp"
 
 namespace file
 {
-    void read_file(editor& ed, const char* filename)
+    namespace
+    {
+        // the files mapped at the moment, for the SIGBUS handler to tell a
+        // fault in one of them from any other
+        struct mapping
+        {
+            std::atomic<std::uintptr_t> begin{};
+            std::atomic<std::size_t> size{};
+        };
+
+        std::array<mapping, 8> mappings;
+        std::atomic<bool> lost_pages{};
+        std::size_t page_size{};
+
+        // a file truncated by another program faults where rows still point
+        // past its new end; a page of zeros in place of the missing one
+        // lets the editor go on. Any other fault is left to the default
+        // action once the handler returns
+        void on_sigbus(int, siginfo_t* info, void*)
+        {
+            auto addr = reinterpret_cast<std::uintptr_t>(info->si_addr);
+            for (const auto& m : mappings) {
+                auto begin = m.begin.load();
+                if (!begin || addr - begin >= m.size.load())
+                    continue;
+                auto* page = reinterpret_cast<void*>(addr & ~(page_size - 1));
+                if (mmap(page, page_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,
+                            -1, 0) != MAP_FAILED) {
+                    lost_pages.store(true, std::memory_order_relaxed);
+                    return;
+                }
+            }
+            std::signal(SIGBUS, SIG_DFL);
+        }
+
+        void watch_mapping(const char* data, std::size_t size)
+        {
+            static const auto installed = []() {
+                page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+                struct sigaction sa{};
+                sa.sa_sigaction = &on_sigbus;
+                sa.sa_flags = SA_SIGINFO;
+                sigemptyset(&sa.sa_mask);
+                return sigaction(SIGBUS, &sa, nullptr) == 0;
+            }();
+            if (!installed)
+                return;
+            // a slot taken has no size until it is set, faults in it are
+            // not ours until then
+            for (auto& m : mappings) {
+                auto none = std::uintptr_t{};
+                if (m.begin.compare_exchange_strong(none, reinterpret_cast<std::uintptr_t>(data))) {
+                    m.size.store(size);
+                    return;
+                }
+            }
+        }
+
+        void unwatch_mapping(const char* data)
+        {
+            for (auto& m : mappings) {
+                auto begin = reinterpret_cast<std::uintptr_t>(data);
+                if (m.begin.load() == begin) {
+                    m.size.store(0);
+                    m.begin.store(0);
+                    return;
+                }
+            }
+        }
+    }
+
+    bool mapped_file::take_lost_pages()
+    {
+        return lost_pages.exchange(false, std::memory_order_relaxed);
+    }
+
+    mapped_file::mapped_file(const char* filename)
+    {
+        auto fd = open(filename, O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            throw std::invalid_argument("file not found");
+        struct stat st{};
+        auto known = !fstat(fd, &st) && S_ISREG(st.st_mode);
+        if (known && st.st_size > 0) {
+            auto size = static_cast<std::size_t>(st.st_size);
+            if (auto* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0); map != MAP_FAILED) {
+                m_data = static_cast<const char*>(map);
+                m_size = size;
+                m_mapped = true;
+                watch_mapping(m_data, m_size);
+            }
+        }
+
+        // read from the same descriptor, a pipe opened again would wait for
+        // another writer. One more than the size, so that the read seeing
+        // the end does not grow the buffer
+        if (!m_mapped) {
+            m_read.resize(known && st.st_size > 0 ? static_cast<std::size_t>(st.st_size) + 1 : BUFSIZ);
+            std::size_t used = 0;
+            for (;;) {
+                if (used == m_read.size())
+                    m_read.resize(m_read.size() * 2);
+                auto n = read(fd, m_read.data() + used, m_read.size() - used);
+                if (n == -1 && errno == EINTR)
+                    continue;
+                if (n <= 0)
+                    break;
+                used += static_cast<std::size_t>(n);
+            }
+            m_read.resize(used);
+            m_data = m_read.data();
+            m_size = m_read.size();
+        }
+        close(fd);
+    }
+
+    mapped_file::~mapped_file()
     {
-        auto fp = file_raii(filename);
-        ed.filename() = fp.filename();
+        if (!m_mapped)
+            return;
+        unwatch_mapping(m_data);
+        munmap(const_cast<char*>(m_data), m_size);
+    }
 
-        for (auto line = fp.next_line(); line.size(); line = fp.next_line())
-            ed.rows().emplace_back(std::move(line.remove_newline()));
+    loaded_file load_rows(const char* filename, const editor_syntax* syntax,
+            command::progress* p)
+    {
+        // the text is split into lines a block at a time and the rows are
+        // made a range of lines at a time, both spread over the workers
+        static constexpr std::size_t BLOCK = 1 << 20;
+        static constexpr std::size_t LINES = 1 << 12;
+
+        auto token = p ? p->token() : cancel_token();
+        auto file = std::make_shared<const mapped_file>(filename);
+        auto text = file->text();
+        auto blocks = (text.size() + BLOCK - 1) / BLOCK;
+        auto newlines = std::vector<std::vector<std::size_t>>(blocks);
+        workers.parallel_for(0, blocks, 1, [&](std::size_t from, std::size_t to) {
+            for (auto b = from; b < to; ++b) {
+                const auto* c = text.data() + b * BLOCK;
+                const auto* end = text.data() + std::min(text.size(), (b + 1) * BLOCK);
+                while ((c = static_cast<const char*>(std::memchr(c, '\n', static_cast<std::size_t>(end - c))))) {
+                    newlines[b].push_back(static_cast<std::size_t>(c - text.data()));
+                    ++c;
+                }
+            }
+        }, task_priority::INTERACTIVE, token);
+
+        // line i is [starts[i], starts[i + 1]) with its newline
+        auto starts = std::vector<std::size_t>{ 0 };
+        for (const auto& block : newlines)
+            for (auto pos : block)
+                starts.push_back(pos + 1);
+        if (starts.back() != text.size())
+            starts.push_back(text.size());
+
+        // rows point into the file until edited, render and highlighting
+        // wait until a row is drawn. A line ends at a NUL, as it did when
+        // read with getline()
+        auto lines = starts.size() - 1;
+        auto rows = std::vector<editor_row>(lines);
+        auto made = std::atomic<std::size_t>();
+        workers.parallel_for(0, lines, LINES, [&](std::size_t from, std::size_t to) {
+            for (auto i = from; i < to; ++i) {
+                const auto* begin = text.data() + starts[i];
+                auto len = starts[i + 1] - starts[i];
+                if (const auto* nul = std::memchr(begin, '\0', len))
+                    len = static_cast<std::size_t>(static_cast<const char*>(nul) - begin);
+                while (len && (begin[len - 1] == '\n' || begin[len - 1] == '\r'))
+                    --len;
+                rows[i].hl_syntax() = syntax;
+                rows[i].borrow({ begin, len });
+            }
+            if (p)
+                p->report(made.fetch_add(to - from, std::memory_order_relaxed) + to - from, lines);
+        }, task_priority::INTERACTIVE, token);
+
+        return { std::move(file), std::move(rows) };
+    }
+
+    void read_file(editor& ed, const char* filename)
+    {
+        auto loaded = load_rows(filename, nullptr);
+        ed.set_rows(std::move(loaded.rows), std::move(loaded.text));
+        ed.filename() = filename;
         ed.set_ft();
     }
 
-    void save_file(editor& ed)
+    void reload_file(editor& ed)
     {
         if (ed.filename().empty()) {
-            ed.filename() = prompt_input(ed, "Save as: ");
-            if (ed.filename().empty()) {
-                ed.status_msg().set_content("Saving aborted");
-                return;
-            }
-            ed.set_ft();
+            ed.status_msg().set_content("No file to reload");
+            return;
         }
 
-        const auto& buf = ed.rows_to_string();
+        command::start(ed.status_msg(), "Reloading",
+                [&ed, filename = ed.filename(), syntax = ed.hl_syntax()](command::progress& p) -> command::finish {
+            auto loaded = load_rows(filename.c_str(), syntax, &p);
+            return [&ed, loaded = std::move(loaded)]() mutable {
+                auto lines = loaded.rows.size();
+                ed.set_rows(std::move(loaded.rows), std::move(loaded.text));
+                ed.status_msg().set_content(std::format("{} lines reloaded", lines).c_str());
+            };
+        });
+    }
 
-        // TODO use file_raii, but first need to change file_raii ctor to be
-        // able to accept O_* flags
-        auto fd = open(ed.filename().c_str(), O_RDWR | O_CREAT, 0644);
-        if (fd != -1 && !ftruncate(fd, static_cast<long>(buf.size()))) {
-            write(fd, buf.c_str(), buf.size());
+    static command::finish save_failed(editor& ed, int err)
+    {
+        return [&ed, err]() {
             ed.status_msg().set_content(
-                    std::format("{} bytes written to disk", buf.size()).c_str());
+                    std::format("Can't save! I/O error: {}", std::strerror(err)).c_str());
+        };
+    }
+
+    static command::finish saved(editor& ed, std::size_t size)
+    {
+        return [&ed, size]() {
+            ed.status_msg().set_content(std::format("{} bytes written to disk", size).c_str());
             ed.dirty() = 0;
-        } else {
+        };
+    }
+
+    // writes `buf` to `fd` a chunk at a time, until done or cancelled before
+    // `p` committed; returns 0 or what went wrong
+    static int write_all(int fd, const str& buf, command::progress& p)
+    {
+        static constexpr std::size_t CHUNK = 1 << 20;
+
+        for (std::size_t off = 0; off < buf.size() && (p.committed() || !p.cancelled());) {
+            auto n = write(fd, buf.c_str() + off, std::min(CHUNK, buf.size() - off));
+            if (n == -1 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return n ? errno : EIO;
+            off += static_cast<std::size_t>(n);
+            p.report(off, buf.size());
+        }
+        return 0;
+    }
+
+    // writes the text over `path` itself, for a file with other names a new
+    // one would split it from or in a directory no new file can be made in,
+    // as long as `path` itself may be written. Rows mustn't point into the
+    // file while it changes, they copy their lines once the work of any
+    // command cancelled for it stopped reading them; once writing started it
+    // isn't cancelled and its result is shown
+    static void write_in_place(editor& ed, str path)
+    {
+        command::start(ed.status_msg(), "Saving",
+                [&ed, path = std::move(path)](command::progress&) -> command::finish {
+            return [&ed, path]() {
+                ed.own_rows();
+                command::start(ed.status_msg(), "Saving",
+                        [&ed, path](command::progress& p) -> command::finish {
+                    if (p.cancelled())
+                        return {};
+                    p.commit();
+                    const auto& buf = ed.rows_to_string();
+                    auto fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+                    if (fd == -1)
+                        return save_failed(ed, errno);
+                    auto err = write_all(fd, buf, p);
+                    if (!err && ftruncate(fd, static_cast<off_t>(buf.size())))
+                        err = errno;
+                    if (close(fd) && !err)
+                        err = errno;
+                    return err ? save_failed(ed, err) : saved(ed, buf.size());
+                });
+            };
+        });
+    }
+
+    // writes the text to a new file next to `path` and renames it over the
+    // old one, a save cancelled or failed halfway leaves the file as it was.
+    // The new file keeps the old one's owner and mode, `st` when `exists`
+    static void write_renamed(editor& ed, str path, struct stat st, bool exists, mode_t mode)
+    {
+        command::start(ed.status_msg(), "Saving",
+                [&ed, path = std::move(path), st, exists, mode](command::progress& p) -> command::finish {
+            const auto& buf = ed.rows_to_string();
+            auto tmp = path;
+            tmp.append(".XXXXXX");
+            // a directory that takes no new file, or a sticky one with
+            // another's file in it, may still let the file be written
+            auto in_place = [&ed, path]() { write_in_place(ed, path); };
+            auto denied = [](int err) { return err == EACCES || err == EPERM || err == EROFS; };
+            auto fd = mkstemp(&tmp[0]);
+            if (fd == -1 && denied(errno))
+                return in_place;
+            if (fd == -1)
+                return save_failed(ed, errno);
+
+            // only root may give a file away, the group is kept at least;
+            // a file saved by another user becomes theirs either way
+            if (exists) {
+                [[maybe_unused]] auto kept = !fchown(fd, st.st_uid, st.st_gid)
+                        || !fchown(fd, static_cast<uid_t>(-1), st.st_gid);
+            }
+            fchmod(fd, exists ? st.st_mode & 07777 : mode);
+            // on the disk before it replaces the old file, a crash leaves
+            // one or the other
+            auto err = write_all(fd, buf, p);
+            if (!err && !p.cancelled() && fsync(fd))
+                err = errno;
+            if (close(fd) && !err)
+                err = errno;
+            if (err || p.cancelled()) {
+                unlink(tmp.c_str());
+                return p.cancelled() ? command::finish() : save_failed(ed, err);
+            }
+            // the rename can't be taken back, cancelling it is too late
+            p.commit();
+            if (rename(tmp.c_str(), path.c_str())) {
+                err = errno;
+                unlink(tmp.c_str());
+                return denied(err) ? in_place : save_failed(ed, err);
+            }
+            return saved(ed, buf.size());
+        });
+    }
+
+    static void write_file(editor& ed)
+    {
+        // a symlink stays one, the file it points to is saved
+        auto path = ed.filename();
+        if (auto* real = realpath(path.c_str(), nullptr)) {
+            path = real;
+            std::free(real);
+        }
+
+        struct stat st{};
+        auto exists = !stat(path.c_str(), &st);
+        // a read-only file stays as it is, though its directory would let
+        // it be replaced
+        if (exists && access(path.c_str(), W_OK)) {
             ed.status_msg().set_content(
                     std::format("Can't save! I/O error: {}", std::strerror(errno)).c_str());
+            return;
         }
+        if (exists && st.st_nlink > 1) {
+            write_in_place(ed, std::move(path));
+            return;
+        }
+        // a new file gets what open() would have given it
+        auto mask = umask(0);
+        umask(mask);
+        write_renamed(ed, std::move(path), st, exists, 0666 & ~mask);
+    }
 
-        close(fd);
+    void save_file(editor& ed)
+    {
+        if (!ed.filename().empty()) {
+            write_file(ed);
+            return;
+        }
+
+        prompt_input(ed, "Save as: ", [](editor& e, const std::optional<str>& filename) {
+            if (!filename || filename->empty()) {
+                e.status_msg().set_content("Saving aborted");
+                return;
+            }
+            e.filename() = *filename;
+            e.set_ft();
+            write_file(e);
+        });
     }
 }
@@ -2,8 +2,12 @@
 
 #include <stdexcept>
 #include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
 #include <stdio.h>
 
+#include "command.hpp"
 #include "editor.hpp"
 #include "str.hpp"
 
@@ -40,20 +44,6 @@ namespace file
         bool eof()
         { return feof(m_fp); }
 
-        str next_line()
-        {
-            auto line = str();
-            char* buf{};
-            size_t size{};
-            ssize_t len{};
-
-            if ((len = getline(&buf, &size, m_fp)) > 0)
-                line = buf;
-            free(buf);
-
-            return line;
-        }
-
         void write_line(const str& line)
         {
             fwrite(line.c_str(), sizeof(char), line.size(), m_fp);
@@ -66,7 +56,56 @@ namespace file
         FILE* m_fp;
     };
 
+    // a file's content mapped read-only, or read in when it can't be mapped,
+    // like a pipe. Saving writes a new file and renames it over the old one,
+    // the mapping goes on showing what was loaded; a file with other names
+    // is written over in place once the rows copied their lines. Another
+    // program writing to the file in place changes it under the editor;
+    // one truncating it would fault the rows past its new end, they read
+    // as zeros instead
+    class mapped_file
+    {
+    public:
+        explicit mapped_file(const char* filename);
+
+        // whether a mapped file lost pages to a truncation since the last
+        // call, rows pointing into it should copy what is left
+        static bool take_lost_pages();
+
+        ~mapped_file();
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        std::string_view text() const
+        { return { this->m_data, this->m_size }; }
+
+    private:
+        const char* m_data{};
+        std::size_t m_size{};
+        bool m_mapped{};
+        std::vector<char> m_read;
+    };
+
+    // the rows of a file and the file they point into
+    struct loaded_file
+    {
+        std::shared_ptr<const mapped_file> text;
+        std::vector<editor_row> rows;
+    };
+
+    // the lines of `filename` as rows borrowing from the mapped file, made
+    // on the workers. `p` hears how far it got, the rows are incomplete once
+    // it is cancelled
+    loaded_file load_rows(const char* filename, const editor_syntax*,
+            command::progress* p = nullptr);
+
     void read_file(editor&, const char*);
 
+    // loads the file again as a command, replacing the text
+    void reload_file(editor&);
+
+    // writes the text to the file as a command, asks for a name first when
+    // it has none
     void save_file(editor&);
 }
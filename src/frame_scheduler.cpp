@@ -0,0 +1,17 @@
+#include "frame_scheduler.hpp"
+
+#include <algorithm>
+
+frame_scheduler frames;
+
+void frame_scheduler::drawn(clock::time_point start, clock::duration took)
+{
+    // move an eighth of the way towards the latest cost
+    m_cost += (took - m_cost) / 8;
+    m_next = start + interval();
+}
+
+frame_scheduler::clock::duration frame_scheduler::interval() const
+{
+    return std::clamp(4 * m_cost, MIN_INTERVAL, MAX_INTERVAL);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+
+// decides when the next frame may be drawn. Frames are at least
+// MIN_INTERVAL apart; the interval stretches to a few times what drawing and
+// writing the last frames took, so a terminal slow to take its output, like
+// one behind a laggy link, gets fewer and larger updates instead of a
+// backlog of stale ones
+class frame_scheduler
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr clock::duration MIN_INTERVAL = std::chrono::microseconds(1'000'000 / 60);
+    static constexpr clock::duration MAX_INTERVAL = std::chrono::milliseconds(250);
+
+    bool due(clock::time_point now) const
+    { return now >= m_next; }
+
+    // time left until a frame is due, zero once it is
+    clock::duration until_due(clock::time_point now) const
+    { return due(now) ? clock::duration::zero() : m_next - now; }
+
+    // records a frame started at `start` that took `took` to draw and write
+    void drawn(clock::time_point start, clock::duration took);
+
+    // the current gap between frames
+    clock::duration interval() const;
+
+private:
+    // smoothed time a frame takes to go out
+    clock::duration m_cost{};
+    clock::time_point m_next{};
+};
+
+extern frame_scheduler frames;
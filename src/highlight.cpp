@@ -0,0 +1,333 @@
+#include "highlight.hpp"
+#include "char_class.hpp"
+#include "editor_keys.hpp"
+
+#include <algorithm>
+#include <limits>
+
+hl_runs::const_iterator hl_runs::upper_bound(std::size_t col) const
+{
+    return std::upper_bound(m_spans.begin(), m_spans.end(), col,
+            [](std::size_t c, const hl_span& span) { return c < span.end(); });
+}
+
+int hl_runs::color_at(std::size_t col) const
+{
+    auto it = upper_bound(col);
+    if (it == m_spans.end() || it->start > col)
+        return colors::DEFAULT;
+    return it->color;
+}
+
+void hl_runs::splice(std::size_t from, std::size_t to, const hl_runs& with, std::ptrdiff_t shift)
+{
+    auto first = std::lower_bound(m_spans.begin(), m_spans.end(), from,
+            [](const hl_span& span, std::size_t c) { return span.start < c; });
+    auto last = std::lower_bound(first, m_spans.end(), to,
+            [](const hl_span& span, std::size_t c) { return span.start < c; });
+    for (auto it = last; it != m_spans.end(); ++it)
+        it->start = static_cast<std::uint32_t>(static_cast<std::ptrdiff_t>(it->start) + shift);
+
+    auto replaced = last - first;
+    auto count = static_cast<std::ptrdiff_t>(with.m_spans.size());
+    if (count > replaced)
+        first = m_spans.insert(first, static_cast<std::size_t>(count - replaced), hl_span{});
+    else
+        first = m_spans.erase(first, first + (replaced - count));
+    std::copy(with.m_spans.begin(), with.m_spans.end(), first);
+}
+
+void hl_builder::paint(std::size_t start, std::size_t len, int color)
+{
+    auto end = std::min(start + len, m_limit);
+    start = std::max(start, m_end);
+    if (start >= end)
+        return;
+    m_end = end;
+    if (color == colors::DEFAULT)
+        return;
+
+    auto& spans = m_runs.m_spans;
+    if (!spans.empty() && spans.back().end() == start && spans.back().color == static_cast<unsigned>(color)) {
+        auto grow = std::min(end - start, hl_span::MAX_LEN - spans.back().len);
+        spans.back() = hl_span::make(spans.back().start, spans.back().len + grow, color);
+        start += grow;
+    }
+    for (; start < end; start += hl_span::MAX_LEN) {
+        auto span_len = std::min(end - start, hl_span::MAX_LEN);
+        spans.push_back(hl_span::make(start, span_len, color));
+    }
+}
+
+int hl_builder::last_color() const
+{
+    const auto& spans = m_runs.m_spans;
+    if (!m_end || spans.empty() || spans.back().end() != m_end)
+        return colors::DEFAULT;
+    return spans.back().color;
+}
+
+namespace
+{
+    // adapts a runtime editor_syntax to the interface of the built-in
+    // policies, so both go through the same highlighting loop
+    struct runtime_policy
+    {
+        keyword_view keywords;
+        std::string_view single_line_comment_syntax;
+        std::string_view multi_line_comment_begin;
+        std::string_view multi_line_comment_end;
+        unsigned int flags;
+
+        runtime_policy(const editor_syntax& syntax)
+            : keywords{syntax.keywords}
+            , single_line_comment_syntax{syntax.single_line_comment_syntax}
+            , multi_line_comment_begin{syntax.multi_line_comment_begin}
+            , multi_line_comment_end{syntax.multi_line_comment_end}
+            , flags{syntax.flags}
+        { }
+    };
+
+    bool match_at(std::string_view s, std::size_t i, std::string_view delim)
+    { return s.substr(i).starts_with(delim); }
+
+    // loop state at a column where highlighting can start over: the column
+    // before it is a separator left uncoloured
+    template<typename policy>
+    hl_state restart_state(const policy& syntax, hl_state entry)
+    {
+        // in_string only changes with HL_STRING
+        return { (syntax.flags & HL_STRING) ? char{} : entry.in_string, 0 };
+    }
+
+    // whether highlighting reached `col` of `render` in restart_state(), known
+    // from the highlighting only. a separator right after a keyword is
+    // skipped without looking at strings, so that case is left out
+    bool restarts_at(std::string_view render, const hl_runs& hl, std::size_t col)
+    {
+        return col == 0
+            || ((char_class::kinds_of(render[col - 1]) & SEPARATOR)
+                    && hl.color_at(col - 1) == colors::DEFAULT
+                    && (col < 2 || hl.color_at(col - 2) != colors::RED));
+    }
+
+    // the last column at or before `col` restarts_at() holds for, skipping
+    // coloured runs as a whole
+    std::size_t restart_before(std::string_view render, const hl_runs& hl, std::size_t col)
+    {
+        while (!restarts_at(render, hl, col)) {
+            auto it = hl.upper_bound(col - 1);
+            if (it != hl.end() && it->start < col)
+                col = it->start;
+            else
+                --col;
+        }
+        return col;
+    }
+
+    struct never_converges
+    {
+        bool operator()(std::size_t, const hl_state&, bool, int) const
+        { return false; }
+    };
+
+    // highlights `render` from column `from` on, which must be 0 or a column
+    // restarts_at() holds for. stops early at the first column `converged`
+    // returns true for and returns where it stopped
+    template<typename policy, typename converged_fn>
+    std::size_t hl_render(const policy& syntax, std::string_view render, hl_builder& hl,
+            hl_state& state, std::size_t from, converged_fn converged)
+    {
+        const auto& cmt_syntax = syntax.single_line_comment_syntax;
+        const auto& comment_begin = syntax.multi_line_comment_begin;
+        const auto& comment_end = syntax.multi_line_comment_end;
+
+        // an empty delimiter matches everywhere, so only non-empty ones can be
+        // found through their lead byte
+        auto cmt_gated = !cmt_syntax.empty() && !comment_begin.empty() && !comment_end.empty();
+        char leads[3]{};
+        std::size_t leads_cnt = 0;
+        for (auto delim : { cmt_syntax, comment_begin, comment_end })
+            if (!delim.empty())
+                leads[leads_cnt++] = delim.front();
+
+        static thread_local char_class cls;
+        cls.scan(render.data(), render.size(), std::string_view(leads, leads_cnt));
+
+        auto& in_string = state.in_string;
+        auto& in_comment = state.in_comment;
+        bool prev_is_sep = true;
+        for (size_t i = from; i < render.size(); ++i) {
+            auto cur_color = colors::DEFAULT;
+            int prev_color = hl.last_color();
+            if (converged(i, state, prev_is_sep, prev_color))
+                return i;
+
+            // walk the set bits: inside comments, strings and plain words
+            // nothing changes until the next separator, quote or comment lead
+            auto stop = i;
+            auto run_color = colors::DEFAULT;
+            if (cmt_gated && in_comment) {
+                stop = cls.next(COMMENT, i);
+                run_color = colors::WHITE;
+            } else if (cmt_gated && !prev_is_sep) {
+                if (in_string && (syntax.flags & HL_STRING)) {
+                    stop = cls.next(SEPARATOR | QUOTE | COMMENT, i);
+                    run_color = colors::YELLOW;
+                } else if (prev_color != colors::CYAN) {
+                    stop = cls.next(SEPARATOR | QUOTE | COMMENT, i);
+                }
+            }
+            if (stop > i) {
+                hl.paint(i, stop - i, run_color);
+                prev_is_sep = cls.is_sep(stop - 1);
+                i = stop - 1;
+                continue;
+            }
+
+            auto hl_nums = [&]() {
+                return ((syntax.flags & HL_NUMBER) &&
+                        cls.is_digit(i)
+                        && (prev_is_sep || prev_color == colors::CYAN))
+                    || (render[i] == '.' && prev_color == colors::CYAN);
+
+            };
+            auto hl_string = [&](char c) {
+                if (!(syntax.flags & HL_STRING))
+                    return false;
+                if (in_string) {
+                    if (c == in_string && i && render[i - 1] != '\\')
+                        in_string = 0;
+                    return true;
+                } else if (cls.test(QUOTE, i)) {
+                    in_string = c;
+                    return true;
+                }
+                return false;
+            };
+            auto hl_single_comment = [&]() {
+                return !in_comment
+                    && (cmt_syntax.empty() || cls.test(COMMENT, i))
+                    && match_at(render, i, cmt_syntax);
+            };
+            auto hl_multi_comment = [&]() {
+                if (in_comment) {
+                    if ((comment_end.empty() || cls.test(COMMENT, i))
+                            && match_at(render, i, comment_end)) {
+                        hl.paint(i, comment_end.size(), colors::WHITE);
+                        i += comment_end.size() - 1;
+                        in_comment = 0;
+                    }
+                    return true;
+                } else if ((comment_begin.empty() || cls.test(COMMENT, i))
+                        && match_at(render, i, comment_begin)) {
+                    hl.paint(i, comment_begin.size(), colors::WHITE);
+                    i += comment_begin.size() - 1;
+                    in_comment = true;
+                    return true;
+                }
+                return false;
+            };
+            auto hl_keyword = [&]() {
+                if (!prev_is_sep)
+                    return false;
+
+                auto len = cls.next(SEPARATOR, i) - i;
+                if (!syntax.keywords.contains(render.substr(i, len)))
+                    return false;
+                hl.paint(i, len, colors::RED);
+                i += len;
+                return true;
+            };
+
+            if (hl_single_comment()) {
+                hl.paint(i, render.size() - i, colors::WHITE);
+                return render.size();
+            } else if (hl_multi_comment()) {
+                cur_color = colors::WHITE;
+            } else if (hl_keyword()) {
+                prev_is_sep = false;
+            } else if (hl_string(render[i])) {
+                cur_color = colors::YELLOW;
+            } else if (hl_nums()) {
+                cur_color = colors::CYAN;
+            }
+            hl.paint(i, 1, cur_color);
+
+            prev_is_sep = cls.is_sep(i);
+        }
+        return render.size();
+    }
+
+    template<typename policy>
+    void hl_full(const policy& syntax, std::string_view render, hl_runs& runs, hl_state& state)
+    {
+        auto hl = hl_builder(runs, render.size());
+        hl_render(syntax, render, hl, state, 0, never_converges{});
+    }
+
+    template<typename policy>
+    void hl_patch(const policy& syntax, std::string_view render, hl_runs& runs,
+            hl_state entry, hl_state& exit, hl_edit edit)
+    {
+        // the columns before the edit highlight the same as before, start
+        // over at the last column the old highlighting can resume from.
+        // the highlighter looks one column ahead of where it is, so the
+        // column at the edit doesn't qualify
+        auto from = std::min(edit.at, render.size());
+        from = restart_before(render, runs, from ? from - 1 : 0);
+
+        auto state = from ? restart_state(syntax, entry) : entry;
+        auto restart = restart_state(syntax, entry);
+        auto shift = static_cast<std::ptrdiff_t>(edit.added) - static_cast<std::ptrdiff_t>(edit.removed);
+        auto unchanged = edit.at + edit.added;
+        // past the edit, every column the old highlighting restarted from
+        // with the state the new one has there continues exactly as before
+        auto converged = [&](std::size_t col, const hl_state& cur, bool prev_is_sep, int prev_color) {
+            if (col <= unchanged || !prev_is_sep || prev_color != colors::DEFAULT || !(cur == restart))
+                return false;
+            auto old_col = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(col) - shift);
+            return runs.color_at(old_col - 1) == colors::DEFAULT
+                && (old_col < 2 || runs.color_at(old_col - 2) != colors::RED);
+        };
+
+        static thread_local hl_runs scratch;
+        auto hl = hl_builder(scratch, render.size());
+        auto stop = hl_render(syntax, render, hl, state, from, converged);
+        if (stop < render.size()) {
+            runs.splice(from, static_cast<std::size_t>(static_cast<std::ptrdiff_t>(stop) - shift),
+                    scratch, shift);
+        } else {
+            runs.splice(from, std::numeric_limits<std::uint32_t>::max(), scratch, 0);
+            exit = state;
+        }
+    }
+}
+
+void hl_generic(const editor_syntax& syntax, std::string_view render, hl_runs& hl, hl_state& state)
+{
+    hl_full(runtime_policy(syntax), render, hl, state);
+}
+
+void hl_patch_generic(const editor_syntax& syntax, std::string_view render, hl_runs& hl,
+        hl_state entry, hl_state& exit, hl_edit edit)
+{
+    hl_patch(runtime_policy(syntax), render, hl, entry, exit, edit);
+}
+
+template<typename policy>
+void hl_builtin(const editor_syntax&, std::string_view render, hl_runs& hl, hl_state& state)
+{
+    hl_full(policy{}, render, hl, state);
+}
+
+template<typename policy>
+void hl_patch_builtin(const editor_syntax&, std::string_view render, hl_runs& hl,
+        hl_state entry, hl_state& exit, hl_edit edit)
+{
+    hl_patch(policy{}, render, hl, entry, exit, edit);
+}
+
+template void hl_builtin<c_policy>(const editor_syntax&, std::string_view, hl_runs&, hl_state&);
+template void hl_patch_builtin<c_policy>(const editor_syntax&, std::string_view, hl_runs&,
+        hl_state, hl_state&, hl_edit);
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "keyword_table.hpp"
+#include "str.hpp"
+
+#define HL_NUMBER (1<<0)
+#define HL_STRING (1<<1)
+
+struct editor_syntax;
+
+// highlighter state carried from the end of one row into the next
+struct hl_state
+{
+    char in_string{};
+    char in_comment{};
+
+    bool operator==(const hl_state&) const = default;
+};
+
+// `len` columns starting at `start` drawn in `color`
+struct hl_span
+{
+    static constexpr std::size_t MAX_LEN = (1 << 24) - 1;
+
+    std::uint32_t start;
+    std::uint32_t len : 24;
+    std::uint32_t color : 8;
+
+    static hl_span make(std::size_t start, std::size_t len, int color)
+    {
+        auto span = hl_span{};
+        span.start = static_cast<std::uint32_t>(start);
+        span.len = static_cast<std::uint32_t>(len & MAX_LEN);
+        span.color = static_cast<std::uint32_t>(color & 0xff);
+        return span;
+    }
+
+    std::size_t end() const
+    { return std::size_t{start} + len; }
+};
+
+// highlighting of one row as sorted, non-overlapping runs; every column not
+// covered by a run is colors::DEFAULT, so unhighlighted rows own no memory
+class hl_runs
+{
+public:
+    using const_iterator = std::vector<hl_span>::const_iterator;
+
+    hl_runs() = default;
+
+    const std::vector<hl_span>& spans() const
+    { return this->m_spans; }
+
+    const_iterator begin() const
+    { return m_spans.begin(); }
+
+    const_iterator end() const
+    { return m_spans.end(); }
+
+    void clear()
+    { m_spans.clear(); }
+
+    // first run ending after `col`
+    const_iterator upper_bound(std::size_t col) const;
+
+    int color_at(std::size_t col) const;
+
+    // replaces the runs within [from, to) by those of `with` and moves the
+    // runs from `to` on by `shift` columns; no run may cross `from` or `to`
+    void splice(std::size_t from, std::size_t to, const hl_runs& with, std::ptrdiff_t shift);
+
+    std::size_t memory() const
+    { return sizeof(*this) + m_spans.capacity() * sizeof(hl_span); }
+
+private:
+    friend class hl_builder;
+
+    std::vector<hl_span> m_spans;
+};
+
+// appends runs strictly left to right; painting a column again is only
+// allowed with the colour it already has, and nothing past `limit` is kept
+class hl_builder
+{
+public:
+    hl_builder(hl_runs& runs, std::size_t limit)
+        : m_runs{runs}
+        , m_limit{limit}
+    { m_runs.clear(); }
+
+    hl_builder(const hl_builder&) = delete;
+    hl_builder& operator=(const hl_builder&) = delete;
+
+    void paint(std::size_t start, std::size_t len, int color);
+
+    // colour of the last painted column
+    int last_color() const;
+
+private:
+    hl_runs& m_runs;
+    std::size_t m_limit;
+    std::size_t m_end{};
+};
+
+// `removed` columns at `at` of a highlighted render replaced by `added` new ones
+struct hl_edit
+{
+    std::size_t at;
+    std::size_t removed;
+    std::size_t added;
+};
+
+using hl_fn = void (*)(const editor_syntax&, std::string_view render, hl_runs& hl, hl_state&);
+
+// brings `hl` and the `exit` state of the render before `edit` up to date
+using hl_patch_fn = void (*)(const editor_syntax&, std::string_view render, hl_runs& hl,
+        hl_state entry, hl_state& exit, hl_edit edit);
+
+struct editor_syntax
+{
+    std::string_view filetype;
+    std::span<const std::string_view> filematches;
+    keyword_view keywords;
+    // TODO wrap comment with optional
+    std::string_view single_line_comment_syntax;
+    std::string_view multi_line_comment_begin;
+    std::string_view multi_line_comment_end;
+    unsigned int flags;
+    hl_fn highlight;
+    hl_patch_fn rehighlight;
+};
+
+// highlights `render` by reading every parameter from the syntax at runtime
+void hl_generic(const editor_syntax&, std::string_view render, hl_runs& hl, hl_state&);
+
+// re-highlights only from a token boundary before the edit until the
+// highlighter reaches a state the old highlighting was in as well
+void hl_patch_generic(const editor_syntax&, std::string_view render, hl_runs& hl,
+        hl_state entry, hl_state& exit, hl_edit);
+
+// highlights `render` with the comment delimiters, keywords and flags of
+// `policy` folded in as constants, the syntax argument is ignored
+template<typename policy>
+void hl_builtin(const editor_syntax&, std::string_view render, hl_runs& hl, hl_state&);
+
+template<typename policy>
+void hl_patch_builtin(const editor_syntax&, std::string_view render, hl_runs& hl,
+        hl_state entry, hl_state& exit, hl_edit);
+
+// a built-in language: everything the highlighter needs as compile-time
+// constants, turned into an HLDB entry by make_syntax()
+struct c_policy
+{
+    static constexpr std::string_view filetype = "c";
+    static constexpr std::array<std::string_view, 3> filematches{
+        ".c", ".cpp", ".h"
+    };
+    static constexpr keyword_table keywords{std::array<std::string_view, 23>{
+        "switch", "if", "while", "for", "break", "continue", "return",
+        "else", "struct", "union", "typedef", "static", "enum", "class",
+        "case", "int", "long", "double", "float", "char", "unsigned",
+        "signed", "void",
+    }};
+    static constexpr std::string_view single_line_comment_syntax = "//";
+    static constexpr std::string_view multi_line_comment_begin = "/*";
+    static constexpr std::string_view multi_line_comment_end = "*/";
+    static constexpr unsigned int flags = HL_NUMBER | HL_STRING;
+};
+
+extern template void hl_builtin<c_policy>(const editor_syntax&, std::string_view, hl_runs&, hl_state&);
+extern template void hl_patch_builtin<c_policy>(const editor_syntax&, std::string_view, hl_runs&,
+        hl_state, hl_state&, hl_edit);
+
+template<typename policy>
+constexpr editor_syntax make_syntax()
+{
+    return {
+        policy::filetype,
+        policy::filematches,
+        policy::keywords.view(),
+        policy::single_line_comment_syntax,
+        policy::multi_line_comment_begin,
+        policy::multi_line_comment_end,
+        policy::flags,
+        &hl_builtin<policy>,
+        &hl_patch_builtin<policy>,
+    };
+}
+
+inline constexpr std::array HLDB{
+    make_syntax<c_policy>(),
+};
@@ -0,0 +1,305 @@
+#include "key_decoder.hpp"
+
+#include <array>
+#include <cstring>
+#include <string_view>
+
+namespace
+{
+    enum state : std::uint8_t
+    {
+        GROUND, IN_ESC, IN_CSI, IN_SS3, STATES,
+        // not in the table, pasted bytes are taken until PASTE_END
+        IN_PASTE = STATES,
+    };
+
+    constexpr std::string_view PASTE_END = "\x1b[201~";
+
+    enum byte_class : std::uint8_t
+    {
+        C_ESC,      // ESC
+        C_DIGIT,    // 0-9
+        C_SEP,      // ; and :
+        C_PRIVATE,  // < = > ? and intermediates, mouse reports and the like
+        C_CSI,      // [
+        C_SS3,      // O
+        C_FINAL,    // the rest of @ to ~
+        C_OTHER,    // control characters and bytes past ASCII
+        CLASSES,
+    };
+
+    enum action : std::uint8_t
+    {
+        NONE,
+        EMIT,       // the byte is a key
+        EMIT_ESC,   // the pending ESC is a key on its own
+        EMIT_ALT,   // the byte is a key pressed with Alt
+        START,      // a new sequence begins
+        DIGIT,
+        NEXT_PARAM,
+        MARK_PRIVATE,
+        DISPATCH_CSI,
+        DISPATCH_SS3,
+    };
+
+    struct transition
+    {
+        state next;
+        action act;
+    };
+
+    constexpr auto CLASS_OF = [] {
+        auto table = std::array<byte_class, 256>{};
+        for (std::size_t b = 0; b < 256; ++b) {
+            auto& cls = table[b];
+            if (b == 0x1b)
+                cls = C_ESC;
+            else if (b >= '0' && b <= '9')
+                cls = C_DIGIT;
+            else if (b == ';' || b == ':')
+                cls = C_SEP;
+            else if ((b >= '<' && b <= '?') || (b >= 0x20 && b <= 0x2f))
+                cls = C_PRIVATE;
+            else if (b == '[')
+                cls = C_CSI;
+            else if (b == 'O')
+                cls = C_SS3;
+            else if (b >= '@' && b <= '~')
+                cls = C_FINAL;
+            else
+                cls = C_OTHER;
+        }
+        return table;
+    }();
+
+    // what a byte of each class does in each state
+    constexpr transition TRANSITIONS[STATES][CLASSES] = {
+        //             ESC                   DIGIT                 SEP                     PRIVATE                   [                         O                         FINAL                     OTHER
+        /* GROUND */ { { IN_ESC, NONE },     { GROUND, EMIT },     { GROUND, EMIT },       { GROUND, EMIT },         { GROUND, EMIT },         { GROUND, EMIT },         { GROUND, EMIT },         { GROUND, EMIT } },
+        /* IN_ESC */ { { IN_ESC, EMIT_ESC }, { GROUND, EMIT_ALT }, { GROUND, EMIT_ALT },   { GROUND, EMIT_ALT },     { IN_CSI, START },        { IN_SS3, START },        { GROUND, EMIT_ALT },     { GROUND, EMIT_ALT } },
+        /* IN_CSI */ { { IN_ESC, NONE },     { IN_CSI, DIGIT },    { IN_CSI, NEXT_PARAM }, { IN_CSI, MARK_PRIVATE }, { GROUND, DISPATCH_CSI }, { GROUND, DISPATCH_CSI }, { GROUND, DISPATCH_CSI }, { GROUND, NONE } },
+        /* IN_SS3 */ { { IN_ESC, NONE },     { IN_SS3, DIGIT },    { IN_SS3, NEXT_PARAM }, { GROUND, NONE },         { GROUND, DISPATCH_SS3 }, { GROUND, DISPATCH_SS3 }, { GROUND, DISPATCH_SS3 }, { GROUND, NONE } },
+    };
+
+    // xterm sends modifiers as one plus a bit set of shift, alt and ctrl
+    std::uint8_t modifiers(unsigned param)
+    {
+        return static_cast<std::uint8_t>(param > 1 ? (param - 1) & 0x7 : 0);
+    }
+
+    // keys of the form CSI <n> ~
+    int tilde_key(unsigned n)
+    {
+        switch (n) {
+            case 1: case 7: return editor_key::HOME;
+            case 2: return editor_key::INSERT;
+            case 3: return editor_key::DEL;
+            case 4: case 8: return editor_key::END;
+            case 5: return editor_key::PAGE_UP;
+            case 6: return editor_key::PAGE_DOWN;
+            case 11: return editor_key::F1;
+            case 12: return editor_key::F2;
+            case 13: return editor_key::F3;
+            case 14: return editor_key::F4;
+            case 15: return editor_key::F5;
+            case 17: return editor_key::F6;
+            case 18: return editor_key::F7;
+            case 19: return editor_key::F8;
+            case 20: return editor_key::F9;
+            case 21: return editor_key::F10;
+            case 23: return editor_key::F11;
+            case 24: return editor_key::F12;
+        }
+        return 0;
+    }
+
+    // keys sent as a final letter after CSI or SS3
+    int letter_key(char final)
+    {
+        switch (final) {
+            case 'A': return editor_key::UP;
+            case 'B': return editor_key::DOWN;
+            case 'C': return editor_key::RIGHT;
+            case 'D': return editor_key::LEFT;
+            case 'H': return editor_key::HOME;
+            case 'F': return editor_key::END;
+            case 'P': return editor_key::F1;
+            case 'Q': return editor_key::F2;
+            case 'R': return editor_key::F3;
+            case 'S': return editor_key::F4;
+        }
+        return 0;
+    }
+}
+
+void key_decoder::feed(const char* data, std::size_t len)
+{
+    for (std::size_t i = 0; i < len;) {
+        if (m_state == IN_PASTE) {
+            i += feed_paste(data + i, len - i);
+            continue;
+        }
+        auto b = static_cast<unsigned char>(data[i++]);
+        auto [next, act] = TRANSITIONS[m_state][CLASS_OF[b]];
+        // a dispatch may go elsewhere
+        m_state = next;
+        switch (act) {
+            case NONE:
+                break;
+            case EMIT:
+                push(b);
+                break;
+            case EMIT_ESC:
+                push(editor_key::ESCAPE);
+                break;
+            case EMIT_ALT:
+                push(b, key_event::ALT);
+                break;
+            case START:
+                m_private = false;
+                m_nparams = 0;
+                break;
+            case DIGIT:
+                if (m_nparams == 0)
+                    m_params[m_nparams++] = 0;
+                if (m_nparams <= MAX_PARAMS)
+                    m_params[m_nparams - 1] = m_params[m_nparams - 1] * 10 + (b - '0');
+                break;
+            case NEXT_PARAM:
+                if (m_nparams == 0)
+                    m_params[m_nparams++] = 0;
+                if (m_nparams < MAX_PARAMS)
+                    m_params[m_nparams] = 0;
+                ++m_nparams;
+                break;
+            case MARK_PRIVATE:
+                m_private = true;
+                break;
+            case DISPATCH_CSI:
+                dispatch_csi(static_cast<char>(b));
+                break;
+            case DISPATCH_SS3:
+                dispatch_ss3(static_cast<char>(b));
+                break;
+        }
+    }
+}
+
+// takes pasted bytes up to the end of the paste, returns how many were
+// taken. Text runs are copied at once, only an ESC is looked at closer
+std::size_t key_decoder::feed_paste(const char* data, std::size_t len)
+{
+    auto& text = m_pastes.back();
+    std::size_t i = 0;
+    while (i < len) {
+        if (m_paste_end == 0) {
+            const auto* esc = static_cast<const char*>(std::memchr(data + i, '\x1b', len - i));
+            auto run = esc ? static_cast<std::size_t>(esc - data) : len;
+            text.append(data + i, run - i);
+            i = run;
+            if (i == len)
+                break;
+        }
+        if (data[i] == PASTE_END[m_paste_end]) {
+            ++i;
+            if (++m_paste_end == PASTE_END.size()) {
+                m_paste_end = 0;
+                m_state = GROUND;
+                push(editor_key::PASTE);
+                break;
+            }
+            continue;
+        }
+        // only looked like the end, the ESC and what followed are text
+        text.append(PASTE_END.data(), m_paste_end);
+        m_paste_end = 0;
+    }
+    return i;
+}
+
+bool key_decoder::pending() const
+{
+    return m_state != GROUND && m_state != IN_PASTE;
+}
+
+bool key_decoder::pasting() const
+{
+    return m_state == IN_PASTE;
+}
+
+void key_decoder::end_paste()
+{
+    if (m_state != IN_PASTE)
+        return;
+    m_pastes.back().append(PASTE_END.data(), m_paste_end);
+    m_paste_end = 0;
+    m_state = GROUND;
+    push(editor_key::PASTE);
+}
+
+void key_decoder::flush()
+{
+    if (m_state == IN_PASTE)
+        return;
+    if (m_state == IN_ESC)
+        push(editor_key::ESCAPE);
+    // nothing came after ESC [ or ESC O, so it was Alt with that key
+    else if (m_state == IN_CSI && m_nparams == 0 && !m_private)
+        push('[', key_event::ALT);
+    else if (m_state == IN_SS3 && m_nparams == 0)
+        push('O', key_event::ALT);
+    m_state = GROUND;
+}
+
+unsigned key_decoder::param(std::size_t i, unsigned fallback) const
+{
+    if (i >= m_nparams || i >= MAX_PARAMS || m_params[i] == 0)
+        return fallback;
+    return m_params[i];
+}
+
+void key_decoder::dispatch_csi(char final)
+{
+    // mouse reports, replies to queries and the like aren't keys
+    if (m_private)
+        return;
+
+    auto mods = modifiers(param(1, 1));
+    switch (final) {
+        case '~':
+            if (param(0, 0) == 200) {
+                m_pastes.emplace_back();
+                m_state = IN_PASTE;
+                return;
+            }
+            if (auto key = tilde_key(param(0, 0)))
+                push(key, mods);
+            return;
+        case 'Z':
+            push('\t', key_event::SHIFT);
+            return;
+        case 'u': {
+            // CSI-u: a key by its code point, only ASCII is a single byte
+            auto code = param(0, 0);
+            if (code == 0 || code > 0x7f)
+                return;
+            int key = static_cast<int>(code);
+            if ((mods & key_event::CTRL) && ((code >= 'a' && code <= 'z') || (code >= '@' && code <= '_')))
+                key = static_cast<int>(code & 0x1f);
+            push(key, mods);
+            return;
+        }
+    }
+    // a first parameter other than 1 is something else, like CSI row;col R
+    // reporting the cursor position
+    if (param(0, 1) != 1)
+        return;
+    if (auto key = letter_key(final))
+        push(key, mods);
+}
+
+void key_decoder::dispatch_ss3(char final)
+{
+    if (auto key = letter_key(final))
+        push(key, modifiers(param(0, 1)));
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include "editor_keys.hpp"
+#include "str.hpp"
+
+// a key press: a byte of text or control character, or an editor_key, and
+// the modifiers held with it
+struct key_event
+{
+    static constexpr std::uint8_t SHIFT = 1 << 0;
+    static constexpr std::uint8_t ALT = 1 << 1;
+    static constexpr std::uint8_t CTRL = 1 << 2;
+
+    int key;
+    std::uint8_t mods{};
+
+    bool operator==(const key_event&) const = default;
+};
+
+// turns terminal input into key events, however it is split across reads.
+// Escape sequences go through a table driven state machine that knows
+// xterm's cursor, editing and function keys with modifiers, SS3 keys,
+// CSI-u and Alt as an ESC prefix; complete sequences it doesn't know are
+// dropped whole instead of leaking their bytes as text. A bracketed paste
+// becomes a single PASTE key with the text taken as it is
+class key_decoder
+{
+public:
+    void feed(const char* data, std::size_t len);
+
+    // input stopped in the middle of a sequence: a lone ESC is the escape
+    // key, ESC [ or ESC O alone are Alt with that key and a cut off sequence
+    // is dropped
+    void flush();
+
+    // whether a sequence is waiting for more bytes; a paste waits for its
+    // end however long it takes
+    bool pending() const;
+
+    bool pasting() const;
+
+    // a paste whose end never came, e.g. from a terminal that died halfway,
+    // becomes a PASTE key with the text taken so far and the keys that
+    // follow are keys again
+    void end_paste();
+
+    bool empty() const
+    { return m_keys.empty(); }
+
+    key_event pop()
+    {
+        auto ev = m_keys.front();
+        m_keys.pop_front();
+        return ev;
+    }
+
+    // the text of the PASTE key popped last
+    str pop_paste()
+    {
+        auto text = std::move(m_pastes.front());
+        m_pastes.pop_front();
+        return text;
+    }
+
+private:
+    static constexpr std::size_t MAX_PARAMS = 4;
+
+    std::uint8_t m_state{};
+    bool m_private{};
+    std::size_t m_nparams{};
+    unsigned m_params[MAX_PARAMS]{};
+    std::deque<key_event> m_keys;
+    std::deque<str> m_pastes;
+    // how much of the end of a paste matched so far
+    std::size_t m_paste_end{};
+
+    unsigned param(std::size_t i, unsigned fallback) const;
+
+    void dispatch_csi(char final);
+
+    void dispatch_ss3(char final);
+
+    std::size_t feed_paste(const char* data, std::size_t len);
+
+    void push(int key, std::uint8_t mods = 0)
+    { m_keys.push_back({ key, mods }); }
+};
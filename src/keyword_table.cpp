@@ -0,0 +1,8 @@
+#include "keyword_table.hpp"
+
+bool keyword_view::contains(std::string_view s) const
+{
+    if (s.empty() || s.size() > m_max_len)
+        return false;
+    return m_slots[keyword_hash(s, m_seed) & m_mask] == s;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+constexpr std::uint32_t keyword_hash(std::string_view s, std::uint32_t seed)
+{
+    // seeded FNV-1a with a final xor-shift to spread the low bits
+    auto h = 2166136261u ^ seed;
+    for (auto c : s) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+// type erased view of a keyword_table, cheap to copy around with the syntax
+class keyword_view
+{
+public:
+    constexpr keyword_view() = default;
+
+    constexpr keyword_view(const std::string_view* slots, std::uint32_t mask,
+            std::uint32_t seed, std::size_t max_len)
+        : m_slots{slots}
+        , m_mask{mask}
+        , m_seed{seed}
+        , m_max_len{max_len}
+    { }
+
+    bool contains(std::string_view) const;
+
+    bool contains(const char* s, std::size_t len) const
+    { return contains(std::string_view(s, len)); }
+
+private:
+    const std::string_view* m_slots{};
+    std::uint32_t m_mask{};
+    std::uint32_t m_seed{};
+    std::size_t m_max_len{};
+};
+
+// perfect hash set over a fixed keyword list, built at compile time: every
+// keyword owns its own slot, so a lookup is one hash and one compare
+template<std::size_t N>
+class keyword_table
+{
+public:
+    static constexpr std::size_t SLOTS = std::bit_ceil(N * 2);
+
+    consteval keyword_table(const std::array<std::string_view, N>& keywords)
+    {
+        for (std::uint32_t seed = 0; seed < MAX_SEED; ++seed) {
+            if (try_seed(keywords, seed))
+                return;
+        }
+        throw std::logic_error("no perfect hash seed for the keyword list");
+    }
+
+    constexpr bool contains(std::string_view s) const
+    {
+        if (s.empty() || s.size() > m_max_len)
+            return false;
+        return m_slots[keyword_hash(s, m_seed) & (SLOTS - 1)] == s;
+    }
+
+    constexpr keyword_view view() const
+    { return { m_slots.data(), SLOTS - 1, m_seed, m_max_len }; }
+
+private:
+    static constexpr std::uint32_t MAX_SEED = 1 << 16;
+
+    std::array<std::string_view, SLOTS> m_slots{};
+    std::uint32_t m_seed{};
+    std::size_t m_max_len{};
+
+    constexpr bool try_seed(const std::array<std::string_view, N>& keywords,
+            std::uint32_t seed)
+    {
+        m_slots = {};
+        m_seed = seed;
+        m_max_len = 0;
+        for (auto keyword : keywords) {
+            auto& slot = m_slots[keyword_hash(keyword, seed) & (SLOTS - 1)];
+            if (!slot.empty())
+                return false;
+            slot = keyword;
+            m_max_len = std::max(m_max_len, keyword.size());
+        }
+        return true;
+    }
+};
@@ -1,9 +1,12 @@
+#include <cstdlib>
 #include <exception>
 
 #include "draw.hpp"
 #include "exception_handler.hpp"
 #include "file_io.hpp"
 #include "read_input.hpp"
+#include "event_loop.hpp"
+#include "render_thread.hpp"
 #include "termios_raii.hpp"
 
 static editor ed;
@@ -13,13 +16,18 @@ int main(int argc, char** argv)
     t_ios.enable_raw_mode();
     std::set_terminate(exception_handler);
 
+    // memory spent on rendered and highlighted rows, in MiB
+    if (const auto* budget = std::getenv("KILO_CACHE_MB"))
+        render_cache.set_budget(std::strtoul(budget, nullptr, 10) << 20);
+
     if (argc >= 2)
         file::read_file(ed, argv[1]);
+    watch_input(ed);
+    renderer.start(STDOUT_FILENO, []() { main_loop.post([]() {}); });
 
-    for (;;) {
-        refresh_screen(ed);
+    // process_key_press draws when the frame scheduler lets it
+    for (;;)
         process_key_press(ed);
-    }
 
     return 0;
 }
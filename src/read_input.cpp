@@ -1,111 +1,298 @@
 #include "read_input.hpp"
+#include "command.hpp"
 #include "draw.hpp"
 #include "editor.hpp"
 #include "file_io.hpp"
 #include "editor_keys.hpp"
+#include "event_loop.hpp"
+#include "frame_scheduler.hpp"
+#include "key_decoder.hpp"
+#include "render_thread.hpp"
+#include "timer_wheel.hpp"
 
+#include <cctype>
+#include <csignal>
+#include <deque>
 #include <format>
 #include <unistd.h>
 
+using namespace std::chrono_literals;
+
+// how long the rest of an escape sequence may take to arrive
+static constexpr auto ESCAPE_TIMEOUT = 100ms;
+// how long a paste may pause before it is taken to have ended without
+// saying so
+static constexpr auto PASTE_TIMEOUT = 1s;
+// how much input one read takes, a paste comes in a few reads
+static constexpr std::size_t READ_SIZE = 4096;
+// how long a message stays in the message bar
+static constexpr auto MSG_TIMEOUT = 2s;
+// how long the keys must pause before the rows further down are highlighted
+static constexpr auto INDEX_DELAY = 500ms;
+// rows highlighted in one go while idle, a few milliseconds' worth
+static constexpr std::size_t INDEX_ROWS = 2048;
+
+// expires when the frame scheduler lets the next frame be drawn
+static timer_fd frame_timer;
+// expires when the rest of an escape sequence or of a paste didn't arrive in
+// time
+static timer_fd escape_timer;
+// what waits for a while without polling, e.g. for the message to expire,
+// and a timer_fd expiring when the earliest of it is due
+static timer_wheel timers;
+static timer_fd wheel_timer;
+// when wheel_timer is set to expire, nothing when it isn't
+static std::optional<timer_wheel::clock::time_point> wheel_armed;
+static debounce msg_expiry{ timers };
+static debounce indexing{ timers };
+static key_decoder keys;
+// whether the screen may no longer show what the editor holds
+static bool stale = true;
+
+// a line of input asked for in the message bar
+struct prompt_state
+{
+    str prompt;
+    str input;
+    prompt_done_fn on_done;
+    prompt_key_fn on_key;
+};
+
+// the prompt the keys go to, if one is open
+static std::optional<prompt_state> prompt;
+// keys read while a command ran, handled once it is done
+static std::deque<key_event> deferred;
+
 static constexpr int ctrl_key(int c)
 { return c & 0x1f; }
 
-static std::optional<int> read_arrow_key()
+// reads what input there is and decodes it
+static void read_input()
 {
-    char seq[3]{};
-    if (read(STDIN_FILENO, &seq[0], 1) != 1)
-        return {};
-    if (read(STDIN_FILENO, &seq[1], 1) != 1)
-        return {};
-    if (seq[0] == '[') {
-        if (seq[1] >= '0' && seq[1] <= '9') {
-            if (read(STDIN_FILENO, &seq[2], 1) != 1)
-                return {};
-            if (seq[2] == '~') {
-                switch (seq[1]) {
-                    case '1': return editor_key::HOME;
-                    case '3': return editor_key::DEL;
-                    case '4': return editor_key::END;
-                    case '5': return editor_key::PAGE_UP;
-                    case '6': return editor_key::PAGE_DOWN;
-                    case '7': return editor_key::HOME;
-                    case '8': return editor_key::END;
-                }
-            }
-        } else {
-            switch (seq[1]) {
-                case 'A': return editor_key::UP;
-                case 'B': return editor_key::DOWN;
-                case 'C': return editor_key::RIGHT;
-                case 'D': return editor_key::LEFT;
-                case 'H': return editor_key::HOME;
-                case 'F': return editor_key::END;
-            }
-        }
-    } else if (seq[0] == '0') {
-        switch (seq[1]) {
-            case 'H': return editor_key::HOME;
-            case 'F': return editor_key::END;
-        }
-    }
-    return {};
+    char buf[READ_SIZE];
+    auto len = read(STDIN_FILENO, buf, sizeof(buf));
+    if (len == -1 && errno != EAGAIN && errno != EINTR)
+        throw std::runtime_error("error on read()");
+    if (len <= 0)
+        return;
+
+    keys.feed(buf, static_cast<std::size_t>(len));
+    if (keys.pending())
+        escape_timer.arm(ESCAPE_TIMEOUT);
+    else if (keys.pasting())
+        escape_timer.arm(PASTE_TIMEOUT);
+    else
+        escape_timer.disarm();
 }
 
-static int read_key()
+void watch_input(editor& ed)
 {
-    ssize_t nread;
-    int c = '\0';
-    while ((nread = read(STDIN_FILENO, &c, 1)) != 1) {
-        if (nread == -1 && errno != EAGAIN)
-            throw std::runtime_error("error on read()");
+    // blocks SIGWINCH, before any thread is started
+    static auto winch = signal_fd{ SIGWINCH };
+
+    main_loop.watch(STDIN_FILENO, &read_input);
+    main_loop.watch(frame_timer.fd(), []() { frame_timer.consume(); });
+    main_loop.watch(escape_timer.fd(), []() {
+        escape_timer.consume();
+        keys.flush();
+        keys.end_paste();
+    });
+    main_loop.watch(wheel_timer.fd(), []() {
+        wheel_timer.consume();
+        wheel_armed.reset();
+        timers.advance(timer_wheel::clock::now());
+    });
+    main_loop.watch(winch.fd(), [&ed]() {
+        while (winch.consume())
+            ;
+        ed.update_screen_size();
+        stale = true;
+    });
+}
+
+// highlights the rows below those seen so far a chunk at a time, the keys
+// read in between stop it until they pause again
+static void index_rows(editor& ed)
+{
+    // the rows belong to a running command, it is usually done by the
+    // time this is tried again
+    if (command::running()) {
+        indexing.poke(INDEX_DELAY, [&ed]() { index_rows(ed); });
+        return;
     }
+    if (ed.index_hl(INDEX_ROWS))
+        indexing.poke(0ms, [&ed]() { index_rows(ed); });
+}
 
-    return c == editor_key::ESCAPE ? read_arrow_key().value_or(c) : c;
+// sets wheel_timer to the earliest timer, if it changed
+static void arm_wheel_timer()
+{
+    auto next = timers.next_expiry();
+    if (next == wheel_armed)
+        return;
+    if (next)
+        wheel_timer.arm(*next - timer_wheel::clock::now());
+    else
+        wheel_timer.disarm();
+    wheel_armed = next;
 }
 
-str prompt_input(editor& ed, const str& prompt,
-        std::optional<std::function<void(editor&, const str&, int c)>> callback)
+// the next key press, those held back while a command ran come first once
+// it is done. Until there is one, main_loop runs whatever else happens,
+// and a frame is drawn once the keys that were already read are handled
+// and the frame scheduler lets it; a burst of keys is drawn once instead
+// of after each of them. Sleeps while nothing happens, timers included
+static key_event next_key(editor& ed)
 {
-    auto input = str();
-
-    for (;;) {
-        auto msg = std::format("{}{}", prompt.c_str(), input.c_str());
-        ed.status_msg().set_content(msg.c_str());
-        refresh_screen(ed);
-
-        int key = read_key();
-        if (key == editor_key::ESCAPE || key == '\r') {
-            if (callback.has_value())
-                callback.value()(ed, input, key);
-            if (key == editor_key::ESCAPE) {
-                ed.status_msg().clear();
-                input.clear();
-            }
-            return input;
+    // when the message shown was set, it is hidden MSG_TIMEOUT after
+    static auto msg_set = std::chrono::steady_clock::time_point();
+    // MSG_TIMEOUT passed while a prompt or a command needed the message
+    static auto msg_due = false;
+    auto ready = []() {
+        return !keys.empty() || (!deferred.empty() && !command::running());
+    };
+
+    // the key before was handled
+    stale = true;
+    if (ed.hl_pending())
+        indexing.poke(INDEX_DELAY, [&ed]() { index_rows(ed); });
+    if (!ready())
+        main_loop.run_once(0ms);
+    while (!ready()) {
+        // work posted to main_loop, like a command reporting progress,
+        // shows in the message bar
+        auto& msg = ed.status_msg();
+        if (msg.timestamp() != msg_set) {
+            msg_set = msg.timestamp();
+            msg_due = false;
+            stale = true;
+            msg_expiry.poke(msg_set + MSG_TIMEOUT - std::chrono::steady_clock::now(),
+                    []() { msg_due = true; });
+        }
+        // a prompt and a command's progress stay until they are done
+        if (msg_due && !prompt && !command::running()) {
+            msg_due = false;
+            msg.expire();
+            stale = true;
         }
 
-        if (key == editor_key::DEL
-                || key == ctrl_key('h')
-                || key == editor_key::BACKSPACE) {
-            if (!input.empty())
-                input.pop_back();
-        } else if (!std::iscntrl(key) && key < EDITOR_KEY_SHIFT) {
-            input.push_back(static_cast<char>(key));
+        auto now = frame_scheduler::clock::now();
+        if (stale && frames.due(now)) {
+            // the renderer wakes main_loop once a frame is free again
+            if (refresh_screen(ed)) {
+                stale = false;
+                frames.drawn(now, frame_scheduler::clock::now() - now + renderer.last_write());
+            }
+        } else if (stale) {
+            frame_timer.arm(frames.until_due(now));
+        }
+        // the rows stop pointing into a file another program truncated,
+        // once no command reads them; drawing may have been what found out
+        if (!command::running() && file::mapped_file::take_lost_pages()) {
+            ed.own_rows();
+            msg.set_content("File truncated on disk, the lines it lost read as NULs");
+            stale = true;
+            continue;
         }
+        arm_wheel_timer();
+        main_loop.run_once(-1ms);
+    }
 
-        if (callback.has_value())
-            callback.value()(ed, input, key);
+    if (!deferred.empty() && !command::running()) {
+        auto key = deferred.front();
+        deferred.pop_front();
+        return key;
     }
+    return keys.pop();
+}
+
+void prompt_input(editor& ed, const str& prompt_msg, prompt_done_fn on_done, prompt_key_fn on_key)
+{
+    prompt = prompt_state{ prompt_msg, str(), std::move(on_done), std::move(on_key) };
+    ed.status_msg().set_content(prompt_msg);
+}
+
+// feeds `key` to the open prompt
+static void prompt_key(editor& ed, int key)
+{
+    if (key == editor_key::ESCAPE || key == '\r') {
+        // closed before the callbacks run, they may open the next prompt
+        auto done = std::move(*prompt);
+        prompt.reset();
+        if (done.on_key)
+            done.on_key(ed, done.input, key);
+        auto input = std::optional<str>();
+        if (key == editor_key::ESCAPE)
+            ed.status_msg().clear();
+        else
+            input = std::move(done.input);
+        if (done.on_done)
+            done.on_done(ed, input);
+        return;
+    }
+
+    auto& input = prompt->input;
+    if (key == editor_key::DEL
+            || key == ctrl_key('h')
+            || key == editor_key::BACKSPACE) {
+        if (!input.empty())
+            input.pop_back();
+    } else if (key == editor_key::PASTE) {
+        // the prompt takes a single line
+        auto text = keys.pop_paste();
+        for (auto c : text) {
+            if (c == '\r' || c == '\n')
+                break;
+            if (!std::iscntrl(static_cast<unsigned char>(c)))
+                input.push_back(c);
+        }
+    } else if (!std::iscntrl(key) && key < EDITOR_KEY_SHIFT) {
+        input.push_back(static_cast<char>(key));
+    }
+
+    // shown before the callback, a command it starts shows its progress
+    // in place of the prompt and puts it back when done
+    auto msg = std::format("{}{}", prompt->prompt.c_str(), input.c_str());
+    ed.status_msg().set_content(msg.c_str());
+    if (prompt->on_key)
+        prompt->on_key(ed, input, key);
+}
+
+// a character held with Alt, or with Ctrl that didn't make it a control
+// character, is a chord nothing is bound to; it isn't text either
+static bool unbound_chord(const key_event& event)
+{
+    if (event.key >= editor_key::UP)
+        return false;
+    return (event.mods & key_event::ALT)
+        || ((event.mods & key_event::CTRL) && !std::iscntrl(event.key));
 }
 
 void process_key_press(editor& ed)
 {
     static unsigned int quit_times = QUIT_TIMES;
+    static unsigned int reload_times = QUIT_TIMES;
     auto& c_row = ed.c_row();
     auto& c_col = ed.c_col();
     const auto& rows = ed.rows();
 
-    auto c = read_key();
+    auto event = next_key(ed);
+    auto c = event.key;
+    if (unbound_chord(event))
+        return;
+    if (prompt) {
+        prompt_key(ed, c);
+        return;
+    }
+    // the text stays as it is while a command reads it
+    if (command::running()) {
+        if (c == editor_key::ESCAPE)
+            command::cancel();
+        else
+            deferred.push_back(event);
+        return;
+    }
+
     switch (c) {
         case '\r':
             ed.insert_newline();
@@ -125,6 +312,18 @@ void process_key_press(editor& ed)
         case ctrl_key('f'):
             ed.find();
             break;
+        case ctrl_key('r'):
+            ed.replace();
+            break;
+        case ctrl_key('o'):
+            if (ed.dirty() && reload_times) {
+                --reload_times;
+                ed.status_msg()
+                    .set_content("File has unsaved changes, press again to reload");
+                return;
+            }
+            file::reload_file(ed);
+            break;
         case editor_key::BACKSPACE:
         case ctrl_key('h'):
         case editor_key::DEL:
@@ -161,11 +360,17 @@ void process_key_press(editor& ed)
         case editor_key::LEFT:
             ed.move_curor(c);
             break;
+        case editor_key::PASTE:
+            ed.paste(keys.pop_paste());
+            break;
         default:
-            ed.insert_char(c);
+            // keys without a binding, like the function keys, aren't text
+            if (c < editor_key::UP)
+                ed.insert_char(c);
             break;
     }
 
     quit_times = QUIT_TIMES;
+    reload_times = QUIT_TIMES;
 }
 
@@ -2,7 +2,19 @@
 
 #include "editor.hpp"
 #include <functional>
+#include <optional>
+
+// runs after every key fed to a prompt, with the input so far
+using prompt_key_fn = std::function<void(editor&, const str&, int c)>;
+// runs once a prompt is done, with its input or nothing after Escape
+using prompt_done_fn = std::function<void(editor&, const std::optional<str>&)>;
+
+// asks for a line of input in the message bar and returns right away. The
+// keys that follow are fed to the prompt instead of the editor until Enter
+// or Escape ends it; `on_key` sees each of them, those two included
+void prompt_input(editor&, const str&, prompt_done_fn on_done, prompt_key_fn on_key = {});
+
+// hands stdin, window size changes, frame timing and timers to main_loop
+void watch_input(editor&);
 
-str prompt_input(editor&, const str&,
-        std::optional<std::function<void(editor&, const str&, int c)>> = {});
 void process_key_press(editor&);
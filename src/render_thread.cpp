@@ -0,0 +1,99 @@
+#include "render_thread.hpp"
+
+#include <cerrno>
+#include <unistd.h>
+
+render_thread renderer;
+
+render_thread::~render_thread()
+{
+    stop();
+}
+
+void render_thread::start(int fd, std::function<void()> on_free)
+{
+    if (running())
+        return;
+    m_fd = fd;
+    m_on_free = std::move(on_free);
+    m_stop.store(false);
+    // the queue is only pushed to from the render thread once it runs
+    for (auto& f : m_frames)
+        m_free.push(&f);
+    m_thread = std::thread(&render_thread::run, this);
+}
+
+void render_thread::stop()
+{
+    if (!running() || std::this_thread::get_id() == m_thread.get_id())
+        return;
+    m_stop.store(true, std::memory_order_release);
+    m_signal.fetch_add(1, std::memory_order_release);
+    m_signal.notify_one();
+    m_thread.join();
+
+    // every frame is back for a later start()
+    while (m_submitted.pop())
+        ;
+    while (m_free.pop())
+        ;
+}
+
+frame* render_thread::acquire()
+{
+    auto f = m_free.pop();
+    return f ? *f : nullptr;
+}
+
+void render_thread::submit(frame* f)
+{
+    m_submitted.push(f);
+    m_signal.fetch_add(1, std::memory_order_release);
+    m_signal.notify_one();
+}
+
+void render_thread::run()
+{
+    for (;;) {
+        auto seen = m_signal.load(std::memory_order_acquire);
+
+        // frames submitted while the last one was written are stale but
+        // for the newest
+        frame* newest = nullptr;
+        while (auto f = m_submitted.pop()) {
+            if (newest)
+                m_free.push(newest);
+            newest = *f;
+        }
+        if (newest) {
+            write_frame(*newest);
+            m_free.push(newest);
+            if (m_on_free)
+                m_on_free();
+            continue;
+        }
+
+        if (m_stop.load(std::memory_order_acquire))
+            return;
+        m_signal.wait(seen, std::memory_order_acquire);
+    }
+}
+
+void render_thread::write_frame(frame& f)
+{
+    auto start = clock::now();
+    const auto& out = m_writer.update(f);
+    const auto* p = out.c_str();
+    auto left = out.size();
+    while (left) {
+        auto n = write(m_fd, p, left);
+        if (n == -1 && errno == EINTR)
+            continue;
+        // the terminal is gone, there is nobody to draw for
+        if (n <= 0)
+            break;
+        p += n;
+        left -= static_cast<std::size_t>(n);
+    }
+    m_write_time.store((clock::now() - start).count(), std::memory_order_relaxed);
+}
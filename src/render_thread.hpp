@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+#include "screen.hpp"
+#include "spsc_queue.hpp"
+
+// writes frames to the terminal on a thread of its own, so that a terminal
+// slow to take a big frame never holds up reading and handling keys. The
+// edit thread composes into one of FRAMES frames and submits it, the render
+// thread writes the newest one submitted and hands the frames back; both
+// ways go through a lock-free queue. While every frame is in flight the
+// edit thread just carries on without drawing
+class render_thread
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t FRAMES = 3;
+
+    render_thread() = default;
+
+    ~render_thread();
+
+    render_thread(const render_thread&) = delete;
+    render_thread& operator=(const render_thread&) = delete;
+
+    // starts writing frames to `fd`. `on_free` runs on the render thread
+    // whenever a written frame comes back, for an edit thread that found
+    // none to try again
+    void start(int fd, std::function<void()> on_free = {});
+
+    // writes what was submitted and ends the thread; does nothing when
+    // called from the render thread itself
+    void stop();
+
+    bool running() const
+    { return this->m_thread.joinable(); }
+
+    // a frame to compose the next one into, nullptr while every frame is
+    // waiting to be written. Edit thread only
+    frame* acquire();
+
+    // hands `f` from acquire() over to be written. Edit thread only
+    void submit(frame* f);
+
+    // how long writing the last frame took
+    clock::duration last_write() const
+    { return clock::duration(m_write_time.load(std::memory_order_relaxed)); }
+
+private:
+    std::array<frame, FRAMES> m_frames;
+    // edit thread to render thread, and back
+    spsc_queue<frame*, 4> m_submitted;
+    spsc_queue<frame*, 4> m_free;
+    // bumped on every submit and on stop, the render thread sleeps on it
+    std::atomic<std::uint32_t> m_signal{};
+    std::atomic<bool> m_stop{};
+    std::atomic<clock::rep> m_write_time{};
+
+    int m_fd{-1};
+    std::function<void()> m_on_free;
+    // used by the render thread only
+    frame_writer m_writer;
+    std::thread m_thread;
+
+    void run();
+
+    void write_frame(frame& f);
+};
+
+extern render_thread renderer;
@@ -0,0 +1,227 @@
+#include "row_cache.hpp"
+#include "char_class.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+row_cache render_cache;
+
+namespace
+{
+    // rough per entry overhead of the list node, the index bucket and the
+    // shared_ptr control block
+    constexpr std::size_t NODE_OVERHEAD = 96;
+
+    // a second fingerprint unrelated to hash_content(): other constants,
+    // the words taken from the end
+    std::uint64_t check_content(const char* s, std::size_t len)
+    {
+        constexpr std::uint64_t K = 0xff51afd7ed558ccdull;
+        auto h = ~static_cast<std::uint64_t>(len);
+        for (; len >= 8; len -= 8) {
+            std::uint64_t w;
+            std::memcpy(&w, s + len - 8, 8);
+            h = (h + w) * K;
+            h ^= h >> 31;
+        }
+        std::uint64_t w = 0;
+        std::memcpy(&w, s, len);
+        h = (h + w) * K;
+        return h ^ (h >> 33);
+    }
+
+    void stamp(std::string_view content, row_render& value)
+    {
+        value.length = content.size();
+        value.check = check_content(content.data(), content.size());
+    }
+
+    bool renders_to(std::string_view content, const row_render& value)
+    {
+        // rows without tabs keep no copy to compare against, a hash
+        // collision has to repeat on the length and the second fingerprint
+        // to show another row's highlighting
+        if (content.size() != value.length)
+            return false;
+        if (!value.has_tabs())
+            return !has_tabs(content) && check_content(content.data(), content.size()) == value.check;
+
+        const auto& render = value.expanded;
+        std::size_t idx = 0;
+        for (auto c : content) {
+            if (c != '\t') {
+                if (idx >= render.size() || render[idx] != c)
+                    return false;
+                ++idx;
+                continue;
+            }
+            for (auto cnt = TABSTOP - idx % TABSTOP; cnt; --cnt, ++idx)
+                if (idx >= render.size() || render[idx] != ' ')
+                    return false;
+        }
+        return idx == render.size();
+    }
+}
+
+std::size_t row_render::memory() const
+{
+    auto bytes = sizeof(*this) + hl.memory() - sizeof(hl);
+    if (expanded.capacity() > 15)
+        bytes += expanded.capacity();
+    return bytes + tabs.capacity() * sizeof(tab_stop);
+}
+
+std::size_t row_render::render_col(std::size_t idx) const
+{
+    // the last tab before `idx` fixes the column, every byte after it is one
+    auto it = std::lower_bound(tabs.begin(), tabs.end(), idx,
+            [](const tab_stop& tab, std::size_t i) { return tab.offset < i; });
+    if (it == tabs.begin())
+        return idx;
+    --it;
+    return it->end + (idx - it->offset - 1);
+}
+
+std::size_t row_render::content_col(std::size_t col) const
+{
+    // the last tab ending at or before `col` fixes the offset
+    auto it = std::upper_bound(tabs.begin(), tabs.end(), col,
+            [](std::size_t c, const tab_stop& tab) { return c < tab.end; });
+    auto idx = col;
+    if (it != tabs.begin())
+        idx = std::prev(it)->offset + 1 + (col - std::prev(it)->end);
+    if (it != tabs.end() && idx > it->offset)
+        return it->offset;
+    return idx;
+}
+
+bool has_tabs(std::string_view s)
+{
+    return std::memchr(s.data(), '\t', s.size()) != nullptr;
+}
+
+std::uint64_t hash_content(const char* s, std::size_t len)
+{
+    // multiply-xorshift over 8 byte words
+    constexpr std::uint64_t K = 0x9e3779b97f4a7c15ull;
+    auto h = static_cast<std::uint64_t>(len) * K;
+    for (; len >= 8; s += 8, len -= 8) {
+        std::uint64_t w;
+        std::memcpy(&w, s, 8);
+        h = (h ^ w) * K;
+        h ^= h >> 32;
+    }
+    std::uint64_t w = 0;
+    std::memcpy(&w, s, len);
+    h = (h ^ w) * K;
+    return h ^ (h >> 29);
+}
+
+void render_content(std::string_view content, str& render, std::vector<tab_stop>& tabs)
+{
+    static thread_local auto offsets = std::vector<std::uint32_t>();
+    offsets.clear();
+    find_all(content.data(), content.size(), '\t', offsets);
+
+    render.clear();
+    render.reserve(content.size() + offsets.size() * (TABSTOP - 1) + 1);
+    tabs.clear();
+    tabs.reserve(offsets.size());
+
+    // copy the runs between tabs whole and pad each tab to the next stop
+    std::size_t from = 0;
+    for (auto tab : offsets) {
+        render.append(content.data() + from, tab - from);
+        render.append(TABSTOP - render.size() % TABSTOP, ' ');
+        tabs.push_back({ tab, static_cast<std::uint32_t>(render.size()) });
+        from = tab + 1;
+    }
+    render.append(content.data() + from, content.size() - from);
+}
+
+std::size_t row_cache::key_hash::operator()(const key& k) const
+{
+    auto h = k.hash ^ reinterpret_cast<std::uintptr_t>(k.syntax);
+    h ^= static_cast<std::uint64_t>(static_cast<unsigned char>(k.entry.in_string)) << 48;
+    h ^= static_cast<std::uint64_t>(static_cast<unsigned char>(k.entry.in_comment)) << 56;
+    return static_cast<std::size_t>(h);
+}
+
+std::shared_ptr<const row_render> row_cache::get(std::string_view content,
+        const editor_syntax* syntax, hl_state entry)
+{
+    return get(content, hash_content(content.data(), content.size()), syntax, entry);
+}
+
+std::shared_ptr<const row_render> row_cache::get(std::string_view content, std::uint64_t hash,
+        const editor_syntax* syntax, hl_state entry)
+{
+    auto k = key{ hash, syntax, entry };
+    auto it = m_index.find(k);
+    if (it != m_index.end() && renders_to(content, *it->second->value)) {
+        ++m_stats.hits;
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return it->second->value;
+    }
+    ++m_stats.misses;
+
+    auto value = std::make_shared<row_render>();
+    if (has_tabs(content))
+        render_content(content, value->expanded, value->tabs);
+    value->exit_state = entry;
+    stamp(content, *value);
+    if (syntax)
+        syntax->highlight(*syntax, value->render(content), value->hl, value->exit_state);
+
+    insert(k, value);
+    return value;
+}
+
+void row_cache::put(std::string_view content, std::uint64_t hash, const editor_syntax* syntax,
+        hl_state entry, std::shared_ptr<row_render> value)
+{
+    stamp(content, *value);
+    insert(key{ hash, syntax, entry }, std::move(value));
+}
+
+void row_cache::insert(const key& k, std::shared_ptr<const row_render> value)
+{
+    // a hash collision replaces the older entry
+    if (auto it = m_index.find(k); it != m_index.end()) {
+        m_stats.bytes -= it->second->bytes;
+        m_lru.erase(it->second);
+        m_index.erase(it);
+    }
+    auto bytes = value->memory() + NODE_OVERHEAD;
+    m_lru.push_front({ k, std::move(value), bytes });
+    m_index.emplace(k, m_lru.begin());
+    m_stats.bytes += bytes;
+    m_stats.entries = m_index.size();
+    evict();
+}
+
+void row_cache::set_budget(std::size_t budget)
+{
+    m_budget = budget;
+    evict();
+}
+
+void row_cache::clear()
+{
+    m_lru.clear();
+    m_index.clear();
+    m_stats.bytes = 0;
+    m_stats.entries = 0;
+}
+
+void row_cache::evict()
+{
+    while (m_stats.bytes > m_budget && !m_lru.empty()) {
+        const auto& victim = m_lru.back();
+        m_stats.bytes -= victim.bytes;
+        m_index.erase(victim.k);
+        m_lru.pop_back();
+        ++m_stats.evictions;
+    }
+    m_stats.entries = m_index.size();
+}
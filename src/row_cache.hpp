@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "highlight.hpp"
+#include "str.hpp"
+
+static constexpr unsigned short TABSTOP = 8;
+
+// a tab at content offset `offset` whose expansion ends before render
+// column `end`
+struct tab_stop
+{
+    std::uint32_t offset;
+    std::uint32_t end;
+};
+
+// everything derived from a row's content: identical rows starting in the
+// same highlighter state share one of these
+struct row_render
+{
+    // the tab expanded content and the tabs in it, sorted by offset; rows
+    // without tabs render as their content and leave both empty
+    str expanded;
+    std::vector<tab_stop> tabs;
+    hl_runs hl;
+    hl_state exit_state;
+    // the content's length and a fingerprint independent of the hash it is
+    // looked up by, a row without tabs has nothing else to be checked
+    // against
+    std::size_t length{};
+    std::uint64_t check{};
+
+    bool has_tabs() const
+    { return !tabs.empty(); }
+
+    std::string_view render(std::string_view content) const
+    { return has_tabs() ? std::string_view(expanded) : content; }
+
+    // render column of content offset `idx`
+    std::size_t render_col(std::size_t idx) const;
+
+    // content offset shown at render column `col`, the tab itself for a
+    // column of its padding
+    std::size_t content_col(std::size_t col) const;
+
+    std::size_t memory() const;
+};
+
+// a row's render and highlighting; `shared` keeps the highlighting alive,
+// `render` may point into the row's own content
+struct render_view
+{
+    std::shared_ptr<const row_render> shared;
+    std::string_view render;
+
+    const hl_runs& hl() const
+    { return this->shared->hl; }
+
+    hl_state exit_state() const
+    { return this->shared->exit_state; }
+
+    std::size_t render_col(std::size_t idx) const
+    { return this->shared->render_col(idx); }
+};
+
+struct row_cache_stats
+{
+    std::size_t hits{};
+    std::size_t misses{};
+    std::size_t evictions{};
+    std::size_t entries{};
+    std::size_t bytes{};
+
+    double hit_rate() const
+    {
+        auto lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+    }
+};
+
+std::uint64_t hash_content(const char*, std::size_t);
+
+bool has_tabs(std::string_view);
+
+void render_content(std::string_view content, str& render, std::vector<tab_stop>& tabs);
+
+// LRU map from (content hash, syntax, entry state) to the shared render and
+// highlighting of that content. Rows don't own their results, so the budget
+// bounds the memory spent on them; an evicted result only lives on while a
+// caller still holds the handle it got
+class row_cache
+{
+public:
+    static constexpr std::size_t DEFAULT_BUDGET = 64 << 20;
+
+    explicit row_cache(std::size_t budget = DEFAULT_BUDGET)
+        : m_budget{budget}
+    { }
+
+    row_cache(const row_cache&) = delete;
+    row_cache& operator=(const row_cache&) = delete;
+
+    std::shared_ptr<const row_render> get(std::string_view content,
+            const editor_syntax*, hl_state entry);
+
+    // same as above with `hash` already known to be hash_content(content)
+    std::shared_ptr<const row_render> get(std::string_view content, std::uint64_t hash,
+            const editor_syntax*, hl_state entry);
+
+    // hands over a result computed elsewhere for `content`, which hashes to
+    // `hash`
+    void put(std::string_view content, std::uint64_t hash, const editor_syntax*,
+            hl_state entry, std::shared_ptr<row_render>);
+
+    const row_cache_stats& stats() const
+    { return this->m_stats; }
+
+    std::size_t budget() const
+    { return this->m_budget; }
+
+    void set_budget(std::size_t);
+
+    void clear();
+
+private:
+    struct key
+    {
+        std::uint64_t hash;
+        const editor_syntax* syntax;
+        hl_state entry;
+
+        bool operator==(const key&) const = default;
+    };
+
+    struct key_hash
+    {
+        std::size_t operator()(const key&) const;
+    };
+
+    struct node
+    {
+        key k;
+        std::shared_ptr<const row_render> value;
+        std::size_t bytes;
+    };
+
+    std::size_t m_budget;
+    row_cache_stats m_stats{};
+    std::list<node> m_lru;
+    std::unordered_map<key, std::list<node>::iterator, key_hash> m_index;
+
+    void insert(const key&, std::shared_ptr<const row_render>);
+
+    void evict();
+};
+
+extern row_cache render_cache;
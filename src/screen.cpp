@@ -0,0 +1,386 @@
+#include "screen.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+using namespace char_seq;
+
+// lines are compared bytewise
+static_assert(sizeof(cell_style) == 2);
+
+namespace
+{
+    // what the terminal is known to be in while a diff is written, npos for
+    // a cursor position that isn't known
+    struct term_state
+    {
+        std::size_t row{str::npos};
+        std::size_t col{str::npos};
+        std::uint8_t color{colors::DEFAULT};
+        std::uint8_t attrs{};
+
+        bool same_style(cell_style s) const
+        { return s.color == color && s.attrs == attrs; }
+    };
+
+    std::size_t num_len(std::size_t n)
+    {
+        std::size_t len = 1;
+        for (; n >= 10; n /= 10)
+            ++len;
+        return len;
+    }
+
+    constexpr std::size_t COLORS = colors::DEFAULT - colors::BLACK + 1;
+
+    // SGR sequences by the change of attributes (none, invert, stop
+    // inverting) and the new colour (none, then BLACK to DEFAULT)
+    constexpr auto SGR = [] {
+        constexpr std::string_view attr_codes[] = { "", "7", "27" };
+        auto table = std::array<std::array<std::array<char, 10>, COLORS + 1>, 3>{};
+        for (std::size_t a = 0; a < 3; ++a) {
+            for (std::size_t c = 0; c <= COLORS; ++c) {
+                auto& seq = table[a][c];
+                std::size_t len = 0;
+                auto put = [&](std::string_view s) {
+                    for (auto ch : s)
+                        seq[len++] = ch;
+                };
+                put("\x1b[");
+                put(attr_codes[a]);
+                if (c) {
+                    if (a)
+                        put(";");
+                    seq[len++] = '3';
+                    seq[len++] = static_cast<char>('0' + c - 1);
+                }
+                put("m");
+            }
+        }
+        return table;
+    }();
+
+    void set_style(term_state& term, cell_style c, str& out)
+    {
+        if (term.same_style(c))
+            return;
+        auto attr = c.attrs == term.attrs ? 0 : c.attrs & cell::INVERT ? 1 : 2;
+        auto color = c.color == term.color ? 0 : c.color - colors::BLACK + 1;
+        out.append(SGR[static_cast<std::size_t>(attr)][static_cast<std::size_t>(color)].data());
+        term.color = c.color;
+        term.attrs = c.attrs;
+    }
+
+    std::size_t cup_len(std::size_t row, std::size_t col)
+    {
+        if (col == 0)
+            return row == 0 ? 3 : 3 + num_len(row + 1);
+        return 4 + num_len(row + 1) + num_len(col + 1);
+    }
+
+    // moves to (`row`, `col`) of `next` by the shortest of an absolute move,
+    // a carriage return, a relative move or writing the cells in between
+    void move_to(term_state& term, const screen& next, std::size_t row, std::size_t col,
+            str& out)
+    {
+        if (term.row == row && term.col == col)
+            return;
+
+        enum class how { ABSOLUTE, RETURN, NEXT_LINE, FORWARD, REWRITE };
+        auto best = how::ABSOLUTE;
+        auto cost = cup_len(row, col);
+        if (term.row == row && term.col != str::npos) {
+            if (col == 0) {
+                best = how::RETURN;
+                cost = 1;
+            } else if (term.col < col) {
+                auto gap = col - term.col;
+                if (3 + num_len(gap) < cost) {
+                    best = how::FORWARD;
+                    cost = 3 + num_len(gap);
+                }
+                const auto* styles = next.styles(row);
+                if (gap < cost && std::all_of(styles + term.col, styles + col,
+                            [&](cell_style s) { return term.same_style(s); }))
+                    best = how::REWRITE;
+            }
+        } else if (term.row != str::npos && term.row + 1 == row && col == 0 && cost > 2) {
+            best = how::NEXT_LINE;
+        }
+
+        switch (best) {
+            case how::ABSOLUTE:
+                move_cursor(row, col, out);
+                break;
+            case how::RETURN:
+                out.push_back('\r');
+                break;
+            case how::NEXT_LINE:
+                out.append(NEW_LINE);
+                break;
+            case how::FORWARD:
+                out.append("\x1b[");
+                append_dec(col - term.col, out);
+                out.push_back('C');
+                break;
+            case how::REWRITE:
+                out.append(next.glyphs(row) + term.col, col - term.col);
+                break;
+        }
+        term.row = row;
+        term.col = col;
+    }
+}
+
+void append_dec(std::size_t n, str& out)
+{
+    char digits[20];
+    std::size_t len = 0;
+    do {
+        digits[len++] = static_cast<char>('0' + n % 10);
+        n /= 10;
+    } while (n);
+    while (len)
+        out.push_back(digits[--len]);
+}
+
+void move_cursor(std::size_t row, std::size_t col, str& out)
+{
+    out.append("\x1b[");
+    if (row || col) {
+        append_dec(row + 1, out);
+        if (col) {
+            out.push_back(';');
+            append_dec(col + 1, out);
+        }
+    }
+    out.push_back('H');
+}
+
+void screen::clear()
+{
+    std::fill(m_glyphs.begin(), m_glyphs.end(), ' ');
+    std::fill(m_styles.begin(), m_styles.end(), cell_style{});
+}
+
+void screen::resize(std::size_t rows, std::size_t cols)
+{
+    m_rows = rows;
+    m_cols = cols;
+    m_glyphs.assign(rows * cols, ' ');
+    m_styles.assign(rows * cols, cell_style{});
+}
+
+std::size_t screen::put(std::size_t row, std::size_t col, std::string_view text,
+        int color, std::uint8_t attrs)
+{
+    auto end = std::min(m_cols, col + text.size());
+    if (end <= col)
+        return col;
+    auto at = row * m_cols + col;
+    std::memcpy(m_glyphs.data() + at, text.data(), end - col);
+    std::fill_n(m_styles.data() + at, end - col,
+            cell_style{ static_cast<std::uint8_t>(color), attrs });
+    return end;
+}
+
+std::size_t screen::fill(std::size_t row, std::size_t col, std::size_t count, char c,
+        int color, std::uint8_t attrs)
+{
+    auto end = std::min(m_cols, col + count);
+    if (end <= col)
+        return col;
+    auto at = row * m_cols + col;
+    std::memset(m_glyphs.data() + at, c, end - col);
+    std::fill_n(m_styles.data() + at, end - col,
+            cell_style{ static_cast<std::uint8_t>(color), attrs });
+    return end;
+}
+
+namespace
+{
+    template<typename T>
+    void scroll_plane(std::vector<T>& plane, std::size_t cols, std::size_t top,
+            std::size_t bottom, std::ptrdiff_t n, T blank)
+    {
+        auto first = plane.begin() + static_cast<std::ptrdiff_t>(top * cols);
+        auto last = plane.begin() + static_cast<std::ptrdiff_t>(bottom * cols);
+        auto lines = static_cast<std::ptrdiff_t>(bottom - top);
+        auto shift = n * static_cast<std::ptrdiff_t>(cols);
+        if (n >= lines || -n >= lines) {
+            std::fill(first, last, blank);
+        } else if (n > 0) {
+            std::copy(first + shift, last, first);
+            std::fill(last - shift, last, blank);
+        } else if (n < 0) {
+            std::copy_backward(first, last + shift, last);
+            std::fill(first, first - shift, blank);
+        }
+    }
+}
+
+void screen::scroll(std::size_t top, std::size_t bottom, std::ptrdiff_t n)
+{
+    scroll_plane(m_glyphs, m_cols, top, bottom, n, ' ');
+    scroll_plane(m_styles, m_cols, top, bottom, n, cell_style{});
+}
+
+namespace
+{
+    // whether each of the `cols` bytes is a printable ASCII character, one
+    // column wide
+    bool plain(const char* text, std::size_t cols)
+    {
+        return std::all_of(text, text + cols,
+                [](char c) { return c >= 0x20 && c < 0x7f; });
+    }
+}
+
+void diff_screen(const screen& prev, const screen& next, str& out)
+{
+    static constexpr auto blank = cell_style{};
+    // an erase costs as much as writing this many cells
+    static constexpr std::size_t ERASE_COST = 3;
+
+    auto term = term_state{};
+    auto fresh = prev.rows() != next.rows() || prev.cols() != next.cols();
+    if (fresh) {
+        out.append(esc_seq::RESET_COLOR);
+        out.append(esc_seq::CLEAR_SCREEN);
+    }
+
+    const auto cols = next.cols();
+    for (std::size_t row = 0; row < next.rows(); ++row) {
+        const auto* text = next.glyphs(row);
+        const auto* styles = next.styles(row);
+        const auto* was_text = fresh ? nullptr : prev.glyphs(row);
+        const auto* was_styles = fresh ? nullptr : prev.styles(row);
+        if (!fresh && std::memcmp(text, was_text, cols) == 0
+                && std::memcmp(styles, was_styles, cols * sizeof(cell_style)) == 0)
+            continue;
+        auto changed = [&](std::size_t col) {
+            if (fresh)
+                return text[col] != ' ' || !(styles[col] == blank);
+            return text[col] != was_text[col] || !(styles[col] == was_styles[col]);
+        };
+
+        // the line is blank from `tail` on
+        auto tail = cols;
+        while (tail && text[tail - 1] == ' ' && styles[tail - 1] == blank)
+            --tail;
+
+        // the terminal counts columns and a cell is a byte: on a line with
+        // a multibyte character or a control byte, now or before, the two
+        // part ways and only rewriting it from the start lands right
+        if (!plain(text, cols) || (!fresh && !plain(was_text, cols))) {
+            move_to(term, next, row, 0, out);
+            for (std::size_t col = 0; col < tail;) {
+                auto end = col + 1;
+                while (end < tail && styles[end] == styles[col])
+                    ++end;
+                set_style(term, styles[col], out);
+                out.append(text + col, end - col);
+                col = end;
+            }
+            if (tail < cols) {
+                set_style(term, blank, out);
+                out.append(esc_seq::CLEAR_LINE);
+            }
+            term.row = term.col = str::npos;
+            continue;
+        }
+
+        for (std::size_t col = 0; col < cols;) {
+            if (!changed(col)) {
+                ++col;
+                continue;
+            }
+            if (col >= tail) {
+                std::size_t left = 0;
+                for (auto i = col; i < cols && left <= ERASE_COST; ++i)
+                    left += changed(i);
+                if (left > ERASE_COST) {
+                    move_to(term, next, row, col, out);
+                    set_style(term, blank, out);
+                    out.append(esc_seq::CLEAR_LINE);
+                    break;
+                }
+            }
+
+            // the changed cells from here in this style, up to the blank end
+            auto end = col + 1;
+            auto limit = col < tail ? tail : cols;
+            while (end < limit && styles[end] == styles[col] && changed(end))
+                ++end;
+
+            move_to(term, next, row, col, out);
+            set_style(term, styles[col], out);
+            out.append(text + col, end - col);
+            term.col = end;
+            // the cursor stays on the last column until the next write
+            if (end == cols)
+                term.row = term.col = str::npos;
+            col = end;
+        }
+    }
+
+    if (!term.same_style(blank))
+        out.append(esc_seq::RESET_COLOR);
+}
+
+void scroll_lines(screen& shown, std::size_t top, std::size_t bottom, std::ptrdiff_t n,
+        str& out)
+{
+    if (n == 0 || top >= bottom)
+        return;
+    shown.scroll(top, bottom, n);
+
+    // set the scroll region, scroll it up (SU) or down (SD) and reset it;
+    // the lines scrolled in are erased in the default colours
+    out.append("\x1b[");
+    append_dec(top + 1, out);
+    out.push_back(';');
+    append_dec(bottom, out);
+    out.push_back('r');
+    out.append("\x1b[");
+    append_dec(static_cast<std::size_t>(n > 0 ? n : -n), out);
+    out.push_back(n > 0 ? 'S' : 'T');
+    out.append("\x1b[r");
+}
+
+const str& frame_writer::update(frame& next)
+{
+    const auto& cells = next.cells;
+    auto& shown = m_shown.cells;
+    if (cells.rows() != shown.rows() || cells.cols() != shown.cols())
+        // a full frame is a byte per cell and the colour changes between
+        m_out.reserve(2 * cells.rows() * cells.cols());
+    m_out.clear();
+    m_out.append(esc_seq::HIDE_CURSOR);
+    const auto nothing = m_out.size();
+
+    // a vertical scroll of the text area is left to the terminal, only the
+    // lines scrolled in are drawn
+    if (shown.rows() == cells.rows() && shown.cols() == cells.cols()
+            && next.text_rows == m_shown.text_rows
+            && next.offset.second == m_shown.offset.second
+            && next.offset.first != m_shown.offset.first) {
+        auto n = static_cast<std::ptrdiff_t>(next.offset.first - m_shown.offset.first);
+        auto rows = static_cast<std::ptrdiff_t>(next.text_rows);
+        if (n < rows && -n < rows)
+            scroll_lines(shown, 0, next.text_rows, n, m_out);
+    }
+    m_shown.offset = next.offset;
+    m_shown.text_rows = next.text_rows;
+    diff_screen(shown, cells, m_out);
+    if (m_out.size() == nothing && next.cursor == m_shown.cursor)
+        return m_out.clear();
+
+    move_cursor(next.cursor.first, next.cursor.second, m_out);
+    m_out.append(esc_seq::SHOW_CURSOR);
+
+    std::swap(shown, next.cells);
+    m_shown.cursor = next.cursor;
+    return m_out;
+}
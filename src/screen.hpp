@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "editor_keys.hpp"
+#include "str.hpp"
+
+// how a terminal cell is drawn
+struct cell_style
+{
+    std::uint8_t color{colors::DEFAULT};
+    std::uint8_t attrs{};
+
+    bool operator==(const cell_style&) const = default;
+};
+
+// one terminal cell: a byte of text, its colour and attributes
+struct cell
+{
+    static constexpr std::uint8_t INVERT = 1 << 0;
+
+    char glyph{' '};
+    std::uint8_t color{colors::DEFAULT};
+    std::uint8_t attrs{};
+
+    bool operator==(const cell&) const = default;
+};
+
+// the terminal's contents as a grid of cells, drawn into instead of writing
+// escape sequences so that frames can be compared cell by cell. Text and
+// styles are kept apart, a line's text is one run of bytes that is copied
+// and sent whole
+class screen
+{
+public:
+    screen() = default;
+
+    screen(std::size_t rows, std::size_t cols)
+    { resize(rows, cols); }
+
+    std::size_t rows() const
+    { return this->m_rows; }
+
+    std::size_t cols() const
+    { return this->m_cols; }
+
+    // blanks every cell, keeping the size
+    void clear();
+
+    // blanks every cell at the new size
+    void resize(std::size_t rows, std::size_t cols);
+
+    const char* glyphs(std::size_t row) const
+    { return m_glyphs.data() + row * m_cols; }
+
+    const cell_style* styles(std::size_t row) const
+    { return m_styles.data() + row * m_cols; }
+
+    cell at(std::size_t row, std::size_t col) const
+    {
+        auto style = styles(row)[col];
+        return { glyphs(row)[col], style.color, style.attrs };
+    }
+
+    // writes `text` from `col` on, cut at the right edge; returns the column
+    // after the last one written
+    std::size_t put(std::size_t row, std::size_t col, std::string_view text,
+            int color = colors::DEFAULT, std::uint8_t attrs = 0);
+
+    // `count` cells of `c` from `col` on, cut at the right edge
+    std::size_t fill(std::size_t row, std::size_t col, std::size_t count, char c,
+            int color = colors::DEFAULT, std::uint8_t attrs = 0);
+
+    // moves lines [top, bottom) up by `n` lines, down for a negative `n`,
+    // blanking the lines scrolled in
+    void scroll(std::size_t top, std::size_t bottom, std::ptrdiff_t n);
+
+private:
+    std::size_t m_rows{}, m_cols{};
+    std::vector<char> m_glyphs;
+    std::vector<cell_style> m_styles;
+};
+
+// appends `n` in decimal
+void append_dec(std::size_t n, str& out);
+
+// appends the move to the zero based screen position (`row`, `col`)
+void move_cursor(std::size_t row, std::size_t col, str& out);
+
+// appends to `out` what turns a terminal showing `prev` into showing `next`,
+// leaving the cursor anywhere. Only changed cells are written, a run of them
+// in one style at once, each run reached by the shortest of a cursor move or
+// rewriting the cells in between. Blank line ends are erased and colours are
+// only set when they change. A `prev` of another size counts as unknown
+// contents and the screen is cleared first. Colours start out and end up
+// reset
+void diff_screen(const screen& prev, const screen& next, str& out);
+
+// appends to `out` what makes the terminal scroll lines [top, bottom) like
+// screen::scroll and does the same to `shown`, its model; leaves the cursor
+// anywhere
+void scroll_lines(screen& shown, std::size_t top, std::size_t bottom, std::ptrdiff_t n,
+        str& out);
+
+// a frame composed from the editor: its cells, where the cursor goes and the
+// scroll offsets the text area, its first `text_rows` lines, was drawn at
+struct frame
+{
+    using position = std::pair<std::size_t, std::size_t>;
+
+    screen cells;
+    position cursor{ str::npos, str::npos };
+    position offset{ str::npos, str::npos };
+    std::size_t text_rows{};
+};
+
+// keeps track of what the terminal shows and turns each new frame into what
+// updates it: a scroll of the text area left to the terminal, the cells
+// that changed and the cursor
+class frame_writer
+{
+public:
+    // returns the bytes that bring the terminal from the last frame to
+    // `next`, nothing when it already shows it; valid until the next call.
+    // Takes the cells of `next`, which ends up with those of an older frame
+    const str& update(frame& next);
+
+private:
+    frame m_shown;
+    str m_out;
+};
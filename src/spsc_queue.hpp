@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+// a bounded lock-free queue between exactly one producer thread and one
+// consumer thread. Each side owns one index and only reads the other's, a
+// slot is handed over by the release store of the index moved past it.
+// Both sides keep a copy of the other's index and only load it again when
+// the copy says the queue is full or empty
+template<typename T, std::size_t N>
+class spsc_queue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "the capacity is a power of two");
+
+public:
+    static constexpr std::size_t capacity()
+    { return N; }
+
+    // producer only, false when the queue is full
+    bool push(T value)
+    {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head_seen == N) {
+            m_head_seen = m_head.load(std::memory_order_acquire);
+            if (tail - m_head_seen == N)
+                return false;
+        }
+        m_slots[tail & (N - 1)] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only, nothing when the queue is empty
+    std::optional<T> pop()
+    {
+        auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail_seen) {
+            m_tail_seen = m_tail.load(std::memory_order_acquire);
+            if (head == m_tail_seen)
+                return {};
+        }
+        auto value = std::move(m_slots[head & (N - 1)]);
+        m_head.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+private:
+    // the indices only grow, the two sides on cache lines of their own
+    static constexpr std::size_t LINE = 64;
+
+    alignas(LINE) std::atomic<std::size_t> m_head{};
+    std::size_t m_tail_seen{};
+    alignas(LINE) std::atomic<std::size_t> m_tail{};
+    std::size_t m_head_seen{};
+    alignas(LINE) std::array<T, N> m_slots{};
+};
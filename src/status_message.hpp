@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <string_view>
+#include <utility>
+
+#include "str.hpp"
+
+static constexpr std::string_view DEFAULT_MSG = "HELP: CTRL-S = save"
+                                           " | CTRL-Q = Quit"
+                                           " | CTRL-F = Find"
+                                           " | CTRL-R = Replace"
+                                           " | CTRL-O = Reload";
+
+class status_message
+{
+public:
+    status_message() = default;
+
+    status_message(str msg)
+    { set_content(std::move(msg)); }
+
+    const str& content() const
+    { return this->m_content; }
+
+    // when the message was set, steady so that it expires the same when the
+    // wall clock is changed
+    const std::chrono::steady_clock::time_point& timestamp() const
+    { return this->m_timestamp; }
+
+    // whether the message timed out; the bar stays empty until the next one
+    bool expired() const
+    { return this->m_expired; }
+
+    void expire()
+    { this->m_expired = true; }
+
+    void set_content(str content)
+    {
+        this->m_content = std::move(content);
+        this->m_timestamp = std::chrono::steady_clock::now();
+        this->m_expired = false;
+    }
+
+    void clear()
+    {
+        this->m_content.clear();
+        this->m_timestamp = std::chrono::steady_clock::now();
+        this->m_expired = false;
+    }
+
+private:
+    str m_content = DEFAULT_MSG.data();
+    std::chrono::steady_clock::time_point m_timestamp = std::chrono::steady_clock::now();
+    bool m_expired{};
+};
@@ -102,17 +102,19 @@ str& str::append(size_type count, value_type c)
 }
 
 str& str::append(const str& s, size_type n)
-{ return this->append(s.c_str(), n); }
+{ return this->append(s.c_str(), std::min(s.size(), n)); }
+
+str& str::append(const_pointer s)
+{ return this->append(s, std::strlen(s)); }
 
 str& str::append(const_pointer s, size_type n)
 {
-    auto copy_size = std::min(std::strlen(s), n);
-    if (!copy_size) [[unlikely]]
+    if (!n) [[unlikely]]
         return *this;
 
-    reserve(m_size + copy_size + 1);
-    std::memcpy(bptr + m_size, s, copy_size);
-    m_size += copy_size;
+    reserve(m_size + n + 1);
+    std::memcpy(bptr + m_size, s, n);
+    m_size += n;
     bptr[m_size] = 0;
 
     return *this;
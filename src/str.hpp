@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iterator>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 
@@ -59,6 +60,9 @@ public:
     const_pointer c_str() const
     { return bptr; }
 
+    operator std::string_view() const
+    { return { bptr, m_size }; }
+
     bool empty() const
     { return !this->m_size; }
 
@@ -124,7 +128,11 @@ public:
 
     str& append(const str&, size_type count = npos);
 
-    str& append(const_pointer, size_type count = npos);
+    // up to the terminating NUL
+    str& append(const_pointer);
+
+    // exactly `count` characters, NULs included, like a row's text
+    str& append(const_pointer, size_type count);
 
     template<typename input_iter>
         str& append(input_iter first, input_iter last)
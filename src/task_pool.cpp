@@ -0,0 +1,163 @@
+#include "task_pool.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <pthread.h>
+#include <signal.h>
+
+task_pool workers;
+
+namespace
+{
+    // which worker of which pool the calling thread is, if any
+    struct worker_id
+    {
+        const task_pool* pool;
+        std::size_t index;
+    };
+
+    thread_local worker_id current{};
+}
+
+task_pool::task_pool(std::size_t threads)
+{
+    threads = std::max<std::size_t>(threads, 1);
+    m_workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i)
+        m_workers.push_back(std::make_unique<worker>());
+}
+
+task_pool::~task_pool()
+{
+    m_stop.store(true, std::memory_order_release);
+    m_signal.fetch_add(1, std::memory_order_release);
+    m_signal.notify_all();
+    for (auto& t : m_threads)
+        t.join();
+}
+
+void task_pool::submit(task fn, task_priority priority, cancel_token token)
+{
+    std::call_once(m_started, [this]() {
+        for (std::size_t i = 0; i < size(); ++i)
+            m_threads.emplace_back(&task_pool::run, this, i);
+    });
+
+    auto self = current.pool == this
+        ? current.index
+        : m_next.fetch_add(1, std::memory_order_relaxed) % size();
+    {
+        auto& w = *m_workers[self];
+        auto lock = std::lock_guard(w.mutex);
+        w.queues[static_cast<std::size_t>(priority)].push_back({ std::move(fn), std::move(token) });
+    }
+    m_signal.fetch_add(1, std::memory_order_release);
+    m_signal.notify_one();
+}
+
+void task_pool::run(std::size_t self)
+{
+    // signals stay with the threads waiting for them, e.g. on a signalfd
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, nullptr);
+    current = { this, self };
+
+    for (;;) {
+        auto seen = m_signal.load(std::memory_order_acquire);
+        if (m_stop.load(std::memory_order_acquire))
+            return;
+        if (run_one(self))
+            continue;
+        m_signal.wait(seen, std::memory_order_acquire);
+    }
+}
+
+bool task_pool::run_one(std::size_t self)
+{
+    auto take = [](worker& w, std::size_t priority, bool own) -> std::optional<job> {
+        auto lock = std::lock_guard(w.mutex);
+        auto& q = w.queues[priority];
+        if (q.empty())
+            return {};
+        // the own newest task is likely still in cache, stealing the oldest
+        // one takes what the owner gets to last
+        auto j = std::optional<job>();
+        if (own) {
+            j = std::move(q.back());
+            q.pop_back();
+        } else {
+            j = std::move(q.front());
+            q.pop_front();
+        }
+        return j;
+    };
+
+    auto n = size();
+    for (std::size_t priority = 0; priority < PRIORITIES; ++priority) {
+        for (std::size_t i = 0; i < n; ++i) {
+            auto j = take(*m_workers[(self + i) % n], priority, i == 0);
+            if (!j)
+                continue;
+            if (!j->token.cancelled())
+                j->fn();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool task_pool::run_ranges(ranges r, task_priority priority, const cancel_token& token)
+{
+    if (r.begin >= r.end)
+        return !token.cancelled();
+
+    struct state
+    {
+        ranges r{};
+        std::size_t count{};
+        cancel_token token;
+        std::atomic<std::size_t> next{}, done{};
+        std::atomic<bool> failed{};
+        std::exception_ptr error{};
+    };
+    auto s = std::make_shared<state>();
+    s->r = r;
+    s->r.grain = std::max<std::size_t>(r.grain, 1);
+    s->count = (r.end - r.begin + s->r.grain - 1) / s->r.grain;
+    s->token = token;
+
+    // a helper that starts after every range was taken returns without
+    // touching the body, which may be gone by then
+    auto work = [s]() {
+        for (auto i = s->next.fetch_add(1, std::memory_order_relaxed); i < s->count;
+                i = s->next.fetch_add(1, std::memory_order_relaxed)) {
+            if (!s->token.cancelled() && !s->failed.load(std::memory_order_relaxed)) {
+                auto from = s->r.begin + i * s->r.grain;
+                auto to = std::min(s->r.end, from + s->r.grain);
+                try {
+                    s->r.call(s->r.body, from, to);
+                } catch (...) {
+                    if (!s->failed.exchange(true))
+                        s->error = std::current_exception();
+                }
+            }
+            if (s->done.fetch_add(1, std::memory_order_acq_rel) + 1 == s->count)
+                s->done.notify_all();
+        }
+    };
+
+    // this thread takes ranges as well, one worker stays free for others
+    auto helpers = std::min(s->count, size()) - 1;
+    for (std::size_t i = 0; i < helpers; ++i)
+        submit(work, priority, token);
+    work();
+
+    for (auto done = s->done.load(std::memory_order_acquire); done != s->count;
+            done = s->done.load(std::memory_order_acquire))
+        s->done.wait(done, std::memory_order_acquire);
+
+    if (s->error)
+        std::rethrow_exception(s->error);
+    return !token.cancelled();
+}
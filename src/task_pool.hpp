@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// interactive tasks are taken before any background one, a background task
+// already running is not interrupted but one split into many small tasks
+// lets interactive ones in between them
+enum class task_priority { INTERACTIVE, BACKGROUND };
+
+// shared between who started some work and the tasks doing it; cancelling
+// drops those still queued and tells running ones to stop at the next check
+class cancel_token
+{
+public:
+    cancel_token()
+        : m_flag{std::make_shared<std::atomic<bool>>(false)}
+    { }
+
+    void cancel() const
+    { m_flag->store(true, std::memory_order_relaxed); }
+
+    bool cancelled() const
+    { return m_flag->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_flag;
+};
+
+// a thread per core, each with a queue per priority. A task submitted from
+// a worker goes to the back of its own queue and is taken from there again,
+// a worker out of work steals from the front of the others'. The threads
+// start with the first task submitted
+class task_pool
+{
+public:
+    using task = std::function<void()>;
+
+    explicit task_pool(std::size_t threads = std::thread::hardware_concurrency());
+
+    ~task_pool();
+
+    task_pool(const task_pool&) = delete;
+    task_pool& operator=(const task_pool&) = delete;
+
+    std::size_t size() const
+    { return this->m_workers.size(); }
+
+    // runs `fn` on some worker unless `token` is cancelled before it starts.
+    // A task must not throw
+    void submit(task fn, task_priority = task_priority::BACKGROUND, cancel_token = {});
+
+    // calls `body(from, to)` for consecutive ranges of at most `grain` of
+    // [begin, end) and returns once all ran; the calling thread runs ranges
+    // too. Ranges not started once `token` is cancelled are skipped, returns
+    // false then. The first exception a range throws is rethrown here
+    template<typename fn>
+    bool parallel_for(std::size_t begin, std::size_t end, std::size_t grain, fn&& body,
+            task_priority priority = task_priority::INTERACTIVE, const cancel_token& token = {})
+    {
+        using body_t = std::remove_reference_t<fn>;
+        auto call = [](void* obj, std::size_t from, std::size_t to) {
+            (*static_cast<body_t*>(obj))(from, to);
+        };
+        return run_ranges({ begin, end, grain, const_cast<void*>(static_cast<const void*>(&body)), call },
+                priority, token);
+    }
+
+private:
+    static constexpr std::size_t PRIORITIES = 2;
+
+    struct job
+    {
+        task fn;
+        cancel_token token;
+    };
+
+    struct worker
+    {
+        std::mutex mutex;
+        std::array<std::deque<job>, PRIORITIES> queues;
+    };
+
+    struct ranges
+    {
+        std::size_t begin, end, grain;
+        void* body;
+        void (*call)(void*, std::size_t, std::size_t);
+    };
+
+    std::vector<std::unique_ptr<worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    std::once_flag m_started;
+    // bumped on every submit and on destruction, idle workers sleep on it
+    std::atomic<std::uint32_t> m_signal{};
+    std::atomic<bool> m_stop{};
+    // where a task submitted from outside the pool goes next
+    std::atomic<std::size_t> m_next{};
+
+    void run(std::size_t self);
+
+    // takes a job from `self`'s queues, or from another worker's, and runs
+    // it; false when there was none
+    bool run_one(std::size_t self);
+
+    bool run_ranges(ranges, task_priority, const cancel_token&);
+};
+
+extern task_pool workers;
@@ -4,6 +4,8 @@
 #include <termios.h>
 #include <unistd.h>
 
+#include "editor_keys.hpp"
+
 class termios_raii
 {
 public:
@@ -25,15 +27,20 @@ public:
         raw.c_oflag &= ~(OPOST);
         raw.c_cflag |= (CS8);
         raw.c_lflag &= ~(ECHO | ICANON | ISIG | IEXTEN);
-        raw.c_cc[VMIN] = 0; // TODO change to 1 maybe
-        raw.c_cc[VTIME] = 1; // TODO change to 1 maybe
+        // reads block for a byte, waiting is left to poll/epoll
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
 
         if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1)
             throw std::runtime_error("termios error");
+        write(STDOUT_FILENO, char_seq::esc_seq::ENABLE_PASTE, 8);
     }
 
     void disable_raw_mode()
-    { tcsetattr(STDIN_FILENO, TCSAFLUSH, &bak); }
+    {
+        write(STDOUT_FILENO, char_seq::esc_seq::DISABLE_PASTE, 8);
+        tcsetattr(STDIN_FILENO, TCSAFLUSH, &bak);
+    }
 
 private:
     termios bak;
@@ -0,0 +1,127 @@
+#include "timer_wheel.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace
+{
+    using clock = timer_wheel::clock;
+
+    // the tick `t` falls in, or the first one not before it when `up`
+    std::uint64_t tick_of(clock::time_point t, bool up)
+    {
+        auto since = std::max(t.time_since_epoch(), clock::duration::zero()).count();
+        auto tick = timer_wheel::TICK.count();
+        return static_cast<std::uint64_t>((since + (up ? tick - 1 : 0)) / tick);
+    }
+
+    clock::time_point time_of(std::uint64_t tick)
+    {
+        return clock::time_point(timer_wheel::TICK * static_cast<clock::rep>(tick));
+    }
+}
+
+timer_wheel::id timer_wheel::schedule(clock::time_point when, handler fn)
+{
+    // one already due waits for the next advance()
+    auto timer = id{ std::max(tick_of(when, true), m_tick + 1), m_next_key++ };
+    m_slots[timer.tick % SLOTS].push_back({ timer.key, timer.tick, std::move(fn) });
+    ++m_size;
+    return timer;
+}
+
+bool timer_wheel::cancel(id timer)
+{
+    if (!timer)
+        return false;
+    // one due by the running advance() is no longer in its slot, it stays
+    // where it is without its handler
+    auto past = timer.tick <= m_tick;
+    auto& from = past ? m_due : m_slots[timer.tick % SLOTS];
+    auto e = std::find_if(from.begin(), from.end(),
+            [&](const entry& x) { return x.key == timer.key && x.fn; });
+    if (e == from.end())
+        return false;
+    if (past) {
+        e->fn = nullptr;
+    } else {
+        *e = std::move(from.back());
+        from.pop_back();
+    }
+    --m_size;
+    return true;
+}
+
+std::optional<timer_wheel::clock::time_point> timer_wheel::next_expiry() const
+{
+    if (!m_size)
+        return {};
+    // the first timer within one lap is the earliest, a slot holds timers
+    // of later laps too
+    for (std::uint64_t tick = m_tick + 1; tick <= m_tick + SLOTS; ++tick)
+        for (const auto& e : m_slots[tick % SLOTS])
+            if (e.tick == tick)
+                return time_of(tick);
+    // every timer is more than a lap away
+    auto earliest = std::numeric_limits<std::uint64_t>::max();
+    for (const auto& slot : m_slots)
+        for (const auto& e : slot)
+            earliest = std::min(earliest, e.tick);
+    return time_of(earliest);
+}
+
+std::size_t timer_wheel::advance(clock::time_point now)
+{
+    auto target = tick_of(now, false);
+    if (target <= m_tick)
+        return 0;
+
+    // a lap visits every slot, a longer wait doesn't need more
+    auto steps = std::min<std::uint64_t>(target - m_tick, SLOTS);
+    m_due.clear();
+    for (std::uint64_t i = 1; i <= steps; ++i) {
+        auto& slot = m_slots[(m_tick + i) % SLOTS];
+        auto kept = std::partition(slot.begin(), slot.end(),
+                [&](const entry& e) { return e.tick > target; });
+        std::move(kept, slot.end(), std::back_inserter(m_due));
+        slot.erase(kept, slot.end());
+    }
+    m_tick = target;
+
+    std::sort(m_due.begin(), m_due.end(), [](const entry& a, const entry& b) {
+        return a.tick != b.tick ? a.tick < b.tick : a.key < b.key;
+    });
+    std::size_t ran = 0;
+    for (auto& e : m_due) {
+        // cancelled by a handler that ran before it
+        if (!e.fn)
+            continue;
+        auto fn = std::move(e.fn);
+        e.fn = nullptr;
+        --m_size;
+        fn();
+        ++ran;
+    }
+    m_due.clear();
+    return ran;
+}
+
+void debounce::poke(clock::duration delay, handler fn)
+{
+    cancel();
+    m_fn = std::move(fn);
+    m_timer = m_wheel.after(delay, [this]() {
+        // done before m_fn, which may poke again
+        m_timer = {};
+        auto call = std::move(m_fn);
+        call();
+    });
+}
+
+void debounce::cancel()
+{
+    if (m_timer)
+        m_wheel.cancel(m_timer);
+    m_timer = {};
+}
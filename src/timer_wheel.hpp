@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+// timers on a hashed wheel of SLOTS slots, TICK apart. A timer goes into the
+// slot its deadline falls on, scheduling and cancelling touch that slot only
+// and advancing visits just the slots passed since the last time. Nothing
+// runs on its own: the owner waits until next_expiry(), e.g. on a timer_fd,
+// and calls advance()
+class timer_wheel
+{
+public:
+    using clock = std::chrono::steady_clock;
+    using handler = std::function<void()>;
+
+    // names a scheduled timer, the tick it is due on leads to its slot
+    struct id
+    {
+        std::uint64_t tick{};
+        std::uint64_t key{};
+
+        explicit operator bool() const
+        { return this->key != 0; }
+    };
+
+    static constexpr clock::duration TICK = std::chrono::milliseconds(1);
+    static constexpr std::size_t SLOTS = 256;
+
+    // runs `fn` once the wheel is advanced to `when`, rounded up to the next
+    // tick
+    id schedule(clock::time_point when, handler fn);
+
+    id after(clock::duration delay, handler fn)
+    { return schedule(clock::now() + delay, std::move(fn)); }
+
+    // drops timer `timer` unless it already ran, returns whether it did
+    bool cancel(id timer);
+
+    // how many timers are waiting
+    std::size_t size() const
+    { return this->m_size; }
+
+    // when the earliest timer is due, nothing without one
+    std::optional<clock::time_point> next_expiry() const;
+
+    // runs every timer due by `now`, earliest first; those scheduled by a
+    // handler run on a later advance(). Returns how many ran
+    std::size_t advance(clock::time_point now);
+
+private:
+    struct entry
+    {
+        std::uint64_t key;
+        std::uint64_t tick;
+        handler fn;
+    };
+
+    std::array<std::vector<entry>, SLOTS> m_slots;
+    std::size_t m_size{};
+    // the tick advanced to last, every timer is due after it
+    std::uint64_t m_tick{};
+    std::uint64_t m_next_key{1};
+    // the timers the running advance() took out of their slots; one
+    // cancelled by a handler before it ran is cleared
+    std::vector<entry> m_due;
+};
+
+// a single call waiting on a wheel; poking it again replaces the one not yet
+// made, so work poked after every key runs once the keys pause
+class debounce
+{
+public:
+    using clock = timer_wheel::clock;
+    using handler = timer_wheel::handler;
+
+    explicit debounce(timer_wheel& wheel)
+        : m_wheel{wheel}
+    { }
+
+    ~debounce()
+    { cancel(); }
+
+    debounce(const debounce&) = delete;
+    debounce& operator=(const debounce&) = delete;
+
+    // runs `fn` after `delay` unless poked or cancelled again before
+    void poke(clock::duration delay, handler fn);
+
+    void cancel();
+
+    bool pending() const
+    { return static_cast<bool>(this->m_timer); }
+
+private:
+    timer_wheel& m_wheel;
+    timer_wheel::id m_timer{};
+    handler m_fn;
+};
@@ -0,0 +1,124 @@
+#include <cctype>
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/char_class.hpp"
+
+class char_class_test : public ::testing::Test
+{
+protected:
+    std::mt19937 mt{};
+    char_class cls;
+
+    void SetUp() override
+    {
+        mt.seed(std::random_device{}());
+    }
+
+    std::string gen_line(std::size_t size)
+    {
+        static constexpr std::string_view alphabet = "abcXYZ0123456789 \t,.()+-/*=~%<>[];'\"\\#_";
+        auto ret = std::string(size, ' ');
+        auto rand_idx = std::uniform_int_distribution<std::size_t>(0, alphabet.size() - 1);
+        for (auto& c : ret)
+            c = alphabet[rand_idx(mt)];
+        return ret;
+    }
+};
+
+TEST_F(char_class_test, empty)
+{
+    cls.scan("", 0);
+    ASSERT_EQ(cls.size(), 0);
+    ASSERT_TRUE(cls.is_sep(0));
+    ASSERT_FALSE(cls.is_digit(0));
+    ASSERT_EQ(cls.next(DIGIT | SEPARATOR, 0), 0);
+}
+
+TEST_F(char_class_test, matches_scalar_classification)
+{
+    for (std::size_t size : { 1, 15, 16, 31, 32, 63, 64, 65, 127, 128, 200, 1000 }) {
+        auto line = gen_line(size);
+        cls.scan(line.c_str(), line.size(), "/*");
+
+        for (std::size_t i = 0; i < line.size(); ++i) {
+            auto c = line[i];
+            ASSERT_EQ(cls.is_digit(i), std::isdigit(c) != 0);
+            ASSERT_EQ(cls.is_sep(i), std::isspace(c) || SEPARATORS.find(c) != std::string_view::npos);
+            ASSERT_EQ(cls.test(QUOTE, i), c == '"' || c == '\'');
+            ASSERT_EQ(cls.test(BACKSLASH, i), c == '\\');
+            ASSERT_EQ(cls.test(COMMENT, i), c == '/' || c == '*');
+        }
+        ASSERT_TRUE(cls.is_sep(line.size()));
+        ASSERT_FALSE(cls.is_digit(line.size()));
+    }
+}
+
+TEST_F(char_class_test, next)
+{
+    auto line = std::string(150, 'a');
+    line[3] = '1';
+    line[70] = '"';
+    line[149] = '\\';
+    cls.scan(line.c_str(), line.size());
+
+    ASSERT_EQ(cls.next(DIGIT, 0), 3);
+    ASSERT_EQ(cls.next(DIGIT, 3), 3);
+    ASSERT_EQ(cls.next(DIGIT, 4), line.size());
+    ASSERT_EQ(cls.next(QUOTE | BACKSLASH, 4), 70);
+    ASSERT_EQ(cls.next(QUOTE | BACKSLASH, 71), 149);
+    ASSERT_EQ(cls.next(SEPARATOR, 0), 70);
+    ASSERT_EQ(cls.next(COMMENT, 0), line.size());
+}
+
+TEST_F(char_class_test, rescan_shorter)
+{
+    auto line = gen_line(300);
+    cls.scan(line.c_str(), line.size());
+    cls.scan("12 ", 3);
+
+    ASSERT_EQ(cls.size(), 3);
+    ASSERT_TRUE(cls.is_digit(1));
+    ASSERT_TRUE(cls.is_sep(2));
+    ASSERT_EQ(cls.next(SEPARATOR, 0), 2);
+    ASSERT_EQ(cls.next(DIGIT, 2), 3);
+}
+
+TEST_F(char_class_test, classifies_in_any_order)
+{
+    auto line = gen_line(1000);
+    auto expected = char_class();
+    expected.scan(line.c_str(), line.size(), "/*");
+    auto kinds = DIGIT | SEPARATOR | QUOTE | BACKSLASH | COMMENT;
+    auto all = std::vector<bool>();
+    for (std::size_t i = 0; i < line.size(); ++i)
+        all.push_back(expected.test(kinds, i));
+
+    // start in the middle, then jump before and after what is classified
+    cls.scan(line.c_str(), line.size(), "/*");
+    for (std::size_t i : { 500, 10, 999, 0, 300, 700 })
+        ASSERT_EQ(cls.test(kinds, i), all[i]);
+    for (std::size_t i = 0; i < line.size(); ++i) {
+        ASSERT_EQ(cls.test(kinds, i), all[i]);
+        ASSERT_EQ((char_class::kinds_of(line[i]) & SEPARATOR) != 0, cls.is_sep(i));
+        ASSERT_EQ((char_class::kinds_of(line[i]) & DIGIT) != 0, cls.is_digit(i));
+    }
+}
+
+TEST_F(char_class_test, find_all)
+{
+    for (std::size_t size : { 0, 1, 15, 16, 31, 32, 33, 64, 100, 1000 }) {
+        auto line = gen_line(size);
+        auto found = std::vector<std::uint32_t>();
+        find_all(line.c_str(), line.size(), '\t', found);
+
+        auto expected = std::vector<std::uint32_t>();
+        for (std::size_t i = 0; i < line.size(); ++i)
+            if (line[i] == '\t')
+                expected.push_back(static_cast<std::uint32_t>(i));
+        ASSERT_EQ(found, expected);
+    }
+}
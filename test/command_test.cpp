@@ -0,0 +1,161 @@
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "../src/command.hpp"
+#include "../src/event_loop.hpp"
+#include "../src/status_message.hpp"
+#include "../src/str.hpp"
+
+using namespace std::chrono_literals;
+
+class command_test : public ::testing::Test
+{
+protected:
+    status_message msg{ "before" };
+
+    // runs main_loop until `pred` holds or a few seconds passed
+    template<typename fn>
+    bool pump_until(fn pred)
+    {
+        auto deadline = std::chrono::steady_clock::now() + 5s;
+        while (!pred() && std::chrono::steady_clock::now() < deadline)
+            main_loop.run_once(10ms);
+        return pred();
+    }
+
+    bool finish()
+    {
+        return pump_until([]() { return !command::running(); });
+    }
+
+    std::string shown() const
+    { return msg.content().c_str(); }
+};
+
+TEST_F(command_test, works_on_a_worker_and_finishes_on_the_main_loop)
+{
+    auto worker = std::thread::id();
+    auto finished_on = std::thread::id();
+    command::start(msg, "Working", [&](command::progress&) -> command::finish {
+        worker = std::this_thread::get_id();
+        return [&]() { finished_on = std::this_thread::get_id(); };
+    });
+    ASSERT_TRUE(command::running());
+    ASSERT_TRUE(finish());
+
+    ASSERT_NE(worker, std::this_thread::get_id());
+    ASSERT_EQ(finished_on, std::this_thread::get_id());
+    ASSERT_EQ(shown(), "before");
+}
+
+TEST_F(command_test, shows_progress_until_done)
+{
+    auto release = std::atomic<bool>();
+    command::start(msg, "Working", [&](command::progress& p) -> command::finish {
+        p.report(1, 4);
+        while (!release)
+            std::this_thread::yield();
+        p.report(4, 4);
+        return [this]() { msg.set_content("done"); };
+    });
+
+    ASSERT_TRUE(pump_until([&]() { return shown() == "Working 25% (ESC to cancel)"; }));
+    release = true;
+    ASSERT_TRUE(finish());
+    ASSERT_EQ(shown(), "done");
+}
+
+TEST_F(command_test, a_cancelled_command_does_not_finish)
+{
+    auto finished = false;
+    command::start(msg, "Working", [&](command::progress& p) -> command::finish {
+        while (!p.cancelled())
+            std::this_thread::yield();
+        return [&]() { finished = true; };
+    });
+    command::cancel();
+    ASSERT_TRUE(finish());
+
+    ASSERT_FALSE(finished);
+    ASSERT_EQ(shown(), "Working cancelled");
+}
+
+TEST_F(command_test, a_new_command_replaces_the_running_one)
+{
+    auto first = false, second = false;
+    command::start(msg, "First", [&](command::progress& p) -> command::finish {
+        while (!p.cancelled())
+            std::this_thread::yield();
+        return [&]() { first = true; };
+    });
+    command::start(msg, "Second", [&](command::progress&) -> command::finish {
+        return [&]() { second = true; };
+    });
+    ASSERT_TRUE(finish());
+
+    ASSERT_FALSE(first);
+    ASSERT_TRUE(second);
+    ASSERT_EQ(shown(), "before");
+}
+
+TEST_F(command_test, a_throwing_command_says_so)
+{
+    command::start(msg, "Working", [](command::progress&) -> command::finish {
+        throw std::runtime_error("disk on fire");
+    });
+    ASSERT_TRUE(finish());
+    ASSERT_EQ(shown(), "Working failed: disk on fire");
+}
+
+TEST_F(command_test, finishes_only_once_cancelled_work_stopped)
+{
+    auto release = std::atomic<bool>();
+    auto first_done = std::atomic<bool>();
+    command::start(msg, "First", [&](command::progress&) -> command::finish {
+        // ignores being cancelled, like work between two checks
+        while (!release)
+            std::this_thread::yield();
+        first_done = true;
+        return {};
+    });
+    auto finished_after_first = std::optional<bool>();
+    command::start(msg, "Second", [&](command::progress&) -> command::finish {
+        return [&]() { finished_after_first = first_done.load(); };
+    });
+
+    // the second work is done long before the first, its finish waits
+    std::this_thread::sleep_for(50ms);
+    main_loop.run_once(10ms);
+    ASSERT_FALSE(finished_after_first);
+    ASSERT_TRUE(command::running());
+
+    release = true;
+    ASSERT_TRUE(finish());
+    ASSERT_EQ(finished_after_first, true);
+}
+
+TEST_F(command_test, a_committed_command_finishes_even_if_cancelled)
+{
+    auto committed = std::atomic<bool>();
+    auto release = std::atomic<bool>();
+    auto finished = false;
+    command::start(msg, "Saving", [&](command::progress& p) -> command::finish {
+        p.commit();
+        committed = true;
+        while (!release)
+            std::this_thread::yield();
+        return [&]() { finished = true; };
+    });
+    ASSERT_TRUE(pump_until([&]() { return committed.load(); }));
+
+    command::cancel();
+    release = true;
+    ASSERT_TRUE(finish());
+    ASSERT_TRUE(finished);
+    ASSERT_EQ(shown(), "before");
+}
@@ -0,0 +1,281 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+// the editor reaches into prompts, drawing and saving, which come along
+#include "../src/draw.hpp"
+#include "../src/editor.hpp"
+#include "../src/editor_keys.hpp"
+#include "../src/file_io.hpp"
+#include "../src/highlight.hpp"
+#include "../src/read_input.hpp"
+#include "../src/str.hpp"
+
+using lines = std::vector<std::string>;
+
+class editor_test : public ::testing::Test
+{
+protected:
+    std::mt19937 mt{};
+    editor ed{ 24, 80 };
+    const editor_syntax* syntax = &HLDB[0];
+
+    void SetUp() override
+    {
+        mt.seed(std::random_device{}());
+    }
+
+    std::size_t pick(std::size_t n)
+    {
+        return std::uniform_int_distribution<std::size_t>(0, n - 1)(mt);
+    }
+
+    static void load(editor& e, const lines& text, const editor_syntax* hl_syntax)
+    {
+        auto rows = std::vector<editor_row>();
+        for (const auto& line : text)
+            rows.emplace_back(str(line.c_str()), hl_syntax);
+        e.hl_syntax() = hl_syntax;
+        e.set_rows(std::move(rows));
+    }
+
+    static lines text_of(const editor& e)
+    {
+        auto ret = lines();
+        for (const auto& row : e.rows())
+            ret.emplace_back(row.text());
+        return ret;
+    }
+
+    // the offset of `pos` in the lines joined by newlines
+    static std::size_t offset_of(const lines& text, text_pos pos)
+    {
+        std::size_t off = 0;
+        for (std::size_t row = 0; row < pos.row; ++row)
+            off += text[row].size() + 1;
+        return off + pos.col;
+    }
+
+    static text_pos pos_of(const lines& text, std::size_t off)
+    {
+        auto pos = text_pos{};
+        while (pos.row + 1 < text.size() && off > text[pos.row].size()) {
+            off -= text[pos.row].size() + 1;
+            ++pos.row;
+        }
+        pos.col = off;
+        return pos;
+    }
+
+    static std::string joined(const lines& text)
+    {
+        auto ret = std::string();
+        for (std::size_t row = 0; row < text.size(); ++row)
+            ret += (row ? "\n" : "") + text[row];
+        return ret;
+    }
+
+    static lines split(const std::string& s)
+    {
+        auto ret = lines{ std::string() };
+        for (auto c : s) {
+            if (c == '\n')
+                ret.emplace_back();
+            else
+                ret.back().push_back(c);
+        }
+        return ret;
+    }
+
+    // `text` with every CR, LF and CR LF made a single LF
+    static std::string newlines(const std::string& text)
+    {
+        auto ret = std::string();
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            if (text[i] == '\r' && i + 1 < text.size() && text[i + 1] == '\n')
+                ++i;
+            ret.push_back(text[i] == '\r' ? '\n' : text[i]);
+        }
+        return ret;
+    }
+
+    std::string gen_text()
+    {
+        static constexpr std::string_view pieces[] = {
+            "a", "xy", " ", "\t", "/*", "*/", "//", "\"", "\r", "\n", "\r\n",
+        };
+        auto ret = std::string();
+        for (auto n = 1 + pick(5); n; --n)
+            ret += pieces[pick(std::size(pieces))];
+        return ret;
+    }
+
+    text_pos gen_pos(const lines& text)
+    {
+        if (text.empty())
+            return {};
+        auto row = pick(text.size());
+        return { row, pick(text[row].size() + 1) };
+    }
+
+    // the highlighting of every row matches that of the same text loaded
+    // afresh
+    void expect_fresh_hl()
+    {
+        auto fresh = editor(24, 80);
+        load(fresh, text_of(ed), syntax);
+        for (std::size_t row = 0; row < ed.rows().size(); ++row) {
+            auto view = ed.row_view(row);
+            auto want = fresh.row_view(row);
+            ASSERT_EQ(ed.rows()[row].entry_state(), fresh.rows()[row].entry_state()) << row;
+            ASSERT_EQ(view.exit_state(), want.exit_state()) << row;
+            ASSERT_EQ(view.render, want.render) << row;
+            for (std::size_t col = 0; col < want.render.size(); ++col)
+                ASSERT_EQ(view.hl().color_at(col), want.hl().color_at(col)) << row << ':' << col;
+        }
+    }
+};
+
+TEST_F(editor_test, insert_splits_on_cr_lf_and_crlf)
+{
+    load(ed, { "ab" }, nullptr);
+    auto after = ed.insert_text({ 0, 1 }, "1\r2\n3\r\n4");
+
+    ASSERT_EQ(text_of(ed), (lines{ "a1", "2", "3", "4b" }));
+    ASSERT_EQ(after, (text_pos{ 3, 1 }));
+}
+
+TEST_F(editor_test, insert_ending_in_a_newline_leaves_an_empty_tail)
+{
+    load(ed, { "ab" }, nullptr);
+    auto after = ed.insert_text({ 0, 2 }, "\r\n");
+
+    ASSERT_EQ(text_of(ed), (lines{ "ab", "" }));
+    ASSERT_EQ(after, (text_pos{ 1, 0 }));
+}
+
+TEST_F(editor_test, insert_after_the_last_row_adds_one)
+{
+    load(ed, { "ab" }, nullptr);
+    auto after = ed.insert_text({ 1, 5 }, "cd\nef");
+
+    ASSERT_EQ(text_of(ed), (lines{ "ab", "cd", "ef" }));
+    ASSERT_EQ(after, (text_pos{ 2, 2 }));
+
+    auto empty = editor(24, 80);
+    empty.insert_text({ 0, 0 }, "x");
+    ASSERT_EQ(text_of(empty), (lines{ "x" }));
+}
+
+TEST_F(editor_test, insert_moves_a_cursor_at_or_behind_it)
+{
+    load(ed, { "abcd", "ef" }, nullptr);
+    auto cursor_after = [&](text_pos cursor) {
+        load(ed, { "abcd", "ef" }, nullptr);
+        ed.c_row() = cursor.row;
+        ed.c_col() = cursor.col;
+        ed.insert_text({ 0, 2 }, "x\ny");
+        return text_pos{ ed.c_row(), ed.c_col() };
+    };
+
+    ASSERT_EQ(cursor_after({ 0, 1 }), (text_pos{ 0, 1 }));
+    ASSERT_EQ(cursor_after({ 0, 2 }), (text_pos{ 1, 1 }));
+    ASSERT_EQ(cursor_after({ 0, 3 }), (text_pos{ 1, 2 }));
+    ASSERT_EQ(cursor_after({ 1, 1 }), (text_pos{ 2, 1 }));
+}
+
+TEST_F(editor_test, erase_joins_rows_and_moves_the_cursor)
+{
+    auto cursor_after = [&](text_pos cursor) {
+        load(ed, { "abcd", "ef", "ghij" }, nullptr);
+        ed.c_row() = cursor.row;
+        ed.c_col() = cursor.col;
+        ed.erase_range({ 0, 2 }, { 2, 1 });
+        return text_pos{ ed.c_row(), ed.c_col() };
+    };
+
+    ASSERT_EQ(cursor_after({ 0, 1 }), (text_pos{ 0, 1 }));
+    ASSERT_EQ(text_of(ed), (lines{ "abhij" }));
+    ASSERT_EQ(cursor_after({ 0, 2 }), (text_pos{ 0, 2 }));
+    ASSERT_EQ(cursor_after({ 1, 1 }), (text_pos{ 0, 2 }));
+    ASSERT_EQ(cursor_after({ 2, 1 }), (text_pos{ 0, 2 }));
+    ASSERT_EQ(cursor_after({ 2, 3 }), (text_pos{ 0, 4 }));
+}
+
+TEST_F(editor_test, comment_opened_and_closed_rehighlights_below)
+{
+    load(ed, { "int a;", "int b;", "int c;" }, syntax);
+    ed.row_view(2);
+
+    ed.insert_text({ 0, 0 }, "/*");
+    ASSERT_EQ(ed.rows()[2].entry_state(), (hl_state{ 0, 1 }));
+    expect_fresh_hl();
+
+    ed.erase_range({ 0, 0 }, { 0, 2 });
+    ASSERT_EQ(ed.rows()[2].entry_state(), hl_state{});
+    expect_fresh_hl();
+}
+
+TEST_F(editor_test, random_edits_match_a_string_model)
+{
+    for (int round = 0; round < 20; ++round) {
+        auto model = lines();
+        for (auto n = pick(4); n; --n)
+            model.push_back(newlines(gen_text()));
+        model = split(joined(model));
+        if (pick(4) == 0)
+            model.clear();
+        load(ed, model, syntax);
+
+        for (int step = 0; step < 60; ++step) {
+            // a cursor somewhere in the text, its offset in the model
+            auto cursor = gen_pos(model);
+            ed.c_row() = cursor.row;
+            ed.c_col() = cursor.col;
+            auto at = offset_of(model, cursor);
+
+            if (model.empty() || pick(2)) {
+                auto pos = gen_pos(model);
+                if (pick(6) == 0)
+                    pos = { model.size(), 0 };
+                auto text = gen_text();
+                auto added = newlines(text);
+
+                if (pos.row == model.size())
+                    model.emplace_back();
+                auto off = offset_of(model, pos);
+                auto s = joined(model);
+                s.insert(off, added);
+                model = split(s);
+                if (at >= off)
+                    at += added.size();
+
+                auto after = ed.insert_text(pos, str(text.c_str()));
+                ASSERT_EQ(after, pos_of(model, off + added.size()));
+            } else {
+                auto from = gen_pos(model), to = gen_pos(model);
+                auto a = offset_of(model, from), b = offset_of(model, to);
+                if (a < b) {
+                    auto s = joined(model);
+                    s.erase(a, b - a);
+                    model = split(s);
+                    if (at > b)
+                        at -= b - a;
+                    else if (at > a)
+                        at = a;
+                }
+                ed.erase_range(from, to);
+            }
+
+            ASSERT_EQ(text_of(ed), model) << round << ':' << step;
+            ASSERT_EQ((text_pos{ ed.c_row(), ed.c_col() }), pos_of(model, at))
+                    << round << ':' << step;
+            // sometimes left behind, the edits also have to cope with rows
+            // not highlighted yet
+            if (pick(3) == 0)
+                expect_fresh_hl();
+        }
+        expect_fresh_hl();
+    }
+}
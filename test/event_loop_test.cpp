@@ -0,0 +1,92 @@
+#include <chrono>
+#include <csignal>
+#include <gtest/gtest.h>
+#include <thread>
+#include <unistd.h>
+
+#include "../src/event_loop.hpp"
+
+using namespace std::chrono_literals;
+
+class event_loop_test : public ::testing::Test
+{
+protected:
+    event_loop loop;
+    int pipe_fds[2]{ -1, -1 };
+
+    void SetUp() override
+    {
+        ASSERT_EQ(pipe(pipe_fds), 0);
+    }
+
+    void TearDown() override
+    {
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+    }
+};
+
+TEST_F(event_loop_test, runs_handler_of_readable_fd)
+{
+    int calls = 0;
+    loop.watch(pipe_fds[0], [&]() {
+        char c;
+        ASSERT_EQ(read(pipe_fds[0], &c, 1), 1);
+        ++calls;
+    });
+
+    ASSERT_EQ(loop.run_once(0ms), 0);
+    ASSERT_EQ(write(pipe_fds[1], "x", 1), 1);
+    ASSERT_EQ(loop.run_once(-1ms), 1);
+    ASSERT_EQ(calls, 1);
+
+    loop.unwatch(pipe_fds[0]);
+    ASSERT_EQ(write(pipe_fds[1], "x", 1), 1);
+    ASSERT_EQ(loop.run_once(0ms), 0);
+    ASSERT_EQ(calls, 1);
+}
+
+TEST_F(event_loop_test, post_wakes_the_loop_from_another_thread)
+{
+    int ran = 0;
+    auto worker = std::thread([&]() {
+        std::this_thread::sleep_for(10ms);
+        loop.post([&]() { ++ran; });
+        loop.post([&]() { ++ran; });
+    });
+
+    while (ran < 2)
+        loop.run_once(-1ms);
+    worker.join();
+    ASSERT_EQ(ran, 2);
+}
+
+TEST_F(event_loop_test, timer_expires_once_armed)
+{
+    auto timer = timer_fd();
+    int fired = 0;
+    loop.watch(timer.fd(), [&]() { fired += static_cast<int>(timer.consume()); });
+
+    ASSERT_EQ(loop.run_once(20ms), 0);
+    timer.arm(5ms);
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(loop.run_once(1000ms), 1);
+    ASSERT_GE(std::chrono::steady_clock::now() - start, 4ms);
+    ASSERT_EQ(fired, 1);
+
+    timer.arm(5ms);
+    timer.disarm();
+    ASSERT_EQ(loop.run_once(20ms), 0);
+}
+
+TEST_F(event_loop_test, signal_arrives_as_readable_fd)
+{
+    auto sig = signal_fd{ SIGUSR1 };
+    int got = 0;
+    loop.watch(sig.fd(), [&]() { got = sig.consume(); });
+
+    ASSERT_EQ(kill(getpid(), SIGUSR1), 0);
+    ASSERT_EQ(loop.run_once(1000ms), 1);
+    ASSERT_EQ(got, SIGUSR1);
+    ASSERT_EQ(sig.consume(), 0);
+}
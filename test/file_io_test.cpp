@@ -0,0 +1,110 @@
+#include <cstdlib>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/file_io.hpp"
+#include "../src/str.hpp"
+
+class file_io_test : public ::testing::Test
+{
+protected:
+    std::string path;
+
+    void TearDown() override
+    {
+        if (!path.empty())
+            unlink(path.c_str());
+    }
+
+    // a new file holding `text`, removed after the test
+    const char* file_of(std::string_view text)
+    {
+        char name[] = "/tmp/kilo_file_io_test.XXXXXX";
+        auto fd = mkstemp(name);
+        EXPECT_NE(fd, -1);
+        EXPECT_EQ(write(fd, text.data(), text.size()), static_cast<ssize_t>(text.size()));
+        close(fd);
+        path = name;
+        return path.c_str();
+    }
+
+    static std::vector<std::string> lines_of(const file::loaded_file& loaded)
+    {
+        auto ret = std::vector<std::string>();
+        for (const auto& row : loaded.rows)
+            ret.emplace_back(row.text());
+        return ret;
+    }
+};
+
+TEST_F(file_io_test, last_line_without_a_newline)
+{
+    auto loaded = file::load_rows(file_of("one\ntwo"), nullptr);
+    ASSERT_EQ(lines_of(loaded), (std::vector<std::string>{ "one", "two" }));
+}
+
+TEST_F(file_io_test, crlf_is_left_out_of_the_rows)
+{
+    auto loaded = file::load_rows(file_of("one\r\ntwo\r\n\r\n"), nullptr);
+    ASSERT_EQ(lines_of(loaded), (std::vector<std::string>{ "one", "two", "" }));
+}
+
+TEST_F(file_io_test, line_ends_at_a_nul)
+{
+    using namespace std::string_view_literals;
+    auto loaded = file::load_rows(file_of("a\0b\nc\n"sv), nullptr);
+    ASSERT_EQ(lines_of(loaded), (std::vector<std::string>{ "a", "c" }));
+}
+
+TEST_F(file_io_test, empty_file_has_no_rows)
+{
+    auto loaded = file::load_rows(file_of(""), nullptr);
+    ASSERT_TRUE(loaded.rows.empty());
+    ASSERT_TRUE(loaded.text->text().empty());
+}
+
+TEST_F(file_io_test, pipe_is_read_instead_of_mapped)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    static constexpr std::string_view text = "one\ntwo\n";
+    ASSERT_EQ(write(fds[1], text.data(), text.size()), static_cast<ssize_t>(text.size()));
+    close(fds[1]);
+
+    auto name = "/dev/fd/" + std::to_string(fds[0]);
+    auto loaded = file::load_rows(name.c_str(), nullptr);
+    close(fds[0]);
+    ASSERT_EQ(lines_of(loaded), (std::vector<std::string>{ "one", "two" }));
+}
+
+TEST_F(file_io_test, borrowed_row_is_copied_on_first_edit)
+{
+    auto loaded = file::load_rows(file_of("one\ntwo\n"), nullptr);
+    auto text = loaded.text->text();
+    auto& row = loaded.rows[1];
+    ASSERT_EQ(row.text().data(), text.data() + 4);
+
+    row.insert(3, 1, 's');
+    ASSERT_EQ(row.text(), "twos");
+    ASSERT_FALSE(row.text().data() >= text.data() && row.text().data() < text.data() + text.size());
+    // the file's text stays as it was
+    ASSERT_EQ(text, "one\ntwo\n");
+}
+
+TEST_F(file_io_test, truncated_file_reads_as_zeros)
+{
+    auto text = std::string();
+    while (text.size() < 3 * 4096)
+        text += "a line of text\n";
+    auto loaded = file::load_rows(file_of(text), nullptr);
+    file::mapped_file::take_lost_pages();
+    ASSERT_EQ(truncate(path.c_str(), 0), 0);
+
+    ASSERT_EQ(loaded.rows.back().text()[0], '\0');
+    ASSERT_TRUE(file::mapped_file::take_lost_pages());
+    ASSERT_FALSE(file::mapped_file::take_lost_pages());
+}
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <gtest/gtest.h>
+
+#include "../src/frame_scheduler.hpp"
+
+using namespace std::chrono_literals;
+
+class frame_scheduler_test : public ::testing::Test
+{
+protected:
+    using clock = frame_scheduler::clock;
+
+    frame_scheduler sched;
+    clock::time_point t0 = clock::time_point{} + 1h;
+};
+
+TEST_F(frame_scheduler_test, first_frame_is_due)
+{
+    ASSERT_TRUE(sched.due(t0));
+    ASSERT_EQ(sched.until_due(t0), clock::duration::zero());
+}
+
+TEST_F(frame_scheduler_test, fast_frames_are_capped)
+{
+    sched.drawn(t0, 50us);
+    ASSERT_EQ(sched.interval(), frame_scheduler::MIN_INTERVAL);
+    ASSERT_FALSE(sched.due(t0 + 1ms));
+    ASSERT_EQ(sched.until_due(t0 + 1ms), frame_scheduler::MIN_INTERVAL - 1ms);
+    ASSERT_TRUE(sched.due(t0 + frame_scheduler::MIN_INTERVAL));
+}
+
+TEST_F(frame_scheduler_test, slow_writes_stretch_the_interval)
+{
+    auto t = t0;
+    for (int i = 0; i < 40; ++i) {
+        sched.drawn(t, 30ms);
+        t += sched.interval();
+    }
+    ASSERT_GT(sched.interval(), 100ms);
+    ASSERT_LE(sched.interval(), frame_scheduler::MAX_INTERVAL);
+
+    // and it recovers once the terminal keeps up again
+    for (int i = 0; i < 80; ++i) {
+        sched.drawn(t, 50us);
+        t += sched.interval();
+    }
+    ASSERT_EQ(sched.interval(), frame_scheduler::MIN_INTERVAL);
+}
+
+TEST_F(frame_scheduler_test, one_stall_does_not_stop_drawing)
+{
+    sched.drawn(t0, 2s);
+    ASSERT_EQ(sched.interval(), frame_scheduler::MAX_INTERVAL);
+    ASSERT_TRUE(sched.due(t0 + frame_scheduler::MAX_INTERVAL));
+}
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+#include "../src/editor_keys.hpp"
+#include "../src/highlight.hpp"
+
+class highlight_test : public ::testing::Test
+{
+protected:
+    std::mt19937 mt{};
+    const editor_syntax& syntax = HLDB[0];
+
+    void SetUp() override
+    {
+        mt.seed(std::random_device{}());
+    }
+
+    std::string gen_line(std::size_t tokens)
+    {
+        static constexpr std::string_view pieces[] = {
+            "if", "int", "x", "12", "3.5", "\"", "'", "\\", "//", "/*", "*/",
+            " ", "  ", "(", ")", ";", "return", "a.b", "char",
+        };
+        auto pick = std::uniform_int_distribution<std::size_t>(0, std::size(pieces) - 1);
+        auto ret = std::string();
+        while (tokens--)
+            ret += pieces[pick(mt)];
+        return ret;
+    }
+
+    void highlight(const std::string& render, hl_runs& hl, hl_state& state)
+    {
+        syntax.highlight(syntax, render, hl, state);
+    }
+
+    static void expect_same(const hl_runs& a, const hl_runs& b)
+    {
+        ASSERT_EQ(a.spans().size(), b.spans().size());
+        for (std::size_t i = 0; i < a.spans().size(); ++i) {
+            ASSERT_EQ(a.spans()[i].start, b.spans()[i].start);
+            ASSERT_EQ(a.spans()[i].len, b.spans()[i].len);
+            ASSERT_EQ(a.spans()[i].color, b.spans()[i].color);
+        }
+    }
+};
+
+TEST_F(highlight_test, runs)
+{
+    auto hl = hl_runs();
+    auto state = hl_state();
+    highlight("int x = 12; // y", hl, state);
+
+    ASSERT_EQ(hl.color_at(0), colors::RED);
+    ASSERT_EQ(hl.color_at(3), colors::DEFAULT);
+    ASSERT_EQ(hl.color_at(8), colors::CYAN);
+    ASSERT_EQ(hl.color_at(12), colors::WHITE);
+    ASSERT_EQ(hl.color_at(15), colors::WHITE);
+    ASSERT_EQ(state, hl_state{});
+}
+
+TEST_F(highlight_test, patch_matches_full_highlight)
+{
+    static constexpr std::string_view inserts = "a1 \"'/*\\.";
+    auto pick = std::uniform_int_distribution<std::size_t>(0, inserts.size() - 1);
+    for (int round = 0; round < 2000; ++round) {
+        auto line = gen_line(mt() % 40);
+        auto entry = hl_state{ 0, static_cast<char>(mt() % 4 == 0) };
+
+        auto patched = hl_runs();
+        auto exit = entry;
+        highlight(line, patched, exit);
+
+        auto at = std::uniform_int_distribution<std::size_t>(0, line.size())(mt);
+        auto edit = hl_edit{ at, 0, 1 };
+        if (mt() % 2 && at < line.size()) {
+            line.erase(at, 1);
+            edit = { at, 1, 0 };
+        } else {
+            line.insert(at, 1, inserts[pick(mt)]);
+        }
+        syntax.rehighlight(syntax, line, patched, entry, exit, edit);
+
+        auto full = hl_runs();
+        auto full_exit = entry;
+        highlight(line, full, full_exit);
+        SCOPED_TRACE(line);
+        expect_same(patched, full);
+        ASSERT_EQ(exit, full_exit);
+    }
+}
+
+TEST_F(highlight_test, patch_replacing_a_range)
+{
+    auto line = std::string("int a; /* b */ char c = 'x';");
+    auto hl = hl_runs();
+    auto exit = hl_state();
+    highlight(line, hl, exit);
+
+    // "/* b */" turned into "// b"
+    line.replace(7, 7, "// b");
+    syntax.rehighlight(syntax, line, hl, {}, exit, { 7, 7, 4 });
+
+    auto full = hl_runs();
+    auto full_exit = hl_state();
+    highlight(line, full, full_exit);
+    expect_same(hl, full);
+    ASSERT_EQ(exit, full_exit);
+}
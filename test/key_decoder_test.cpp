@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include <string_view>
+#include <vector>
+
+#include "../src/key_decoder.hpp"
+
+class key_decoder_test : public ::testing::Test
+{
+protected:
+    key_decoder dec;
+
+    std::vector<key_event> drain()
+    {
+        auto ret = std::vector<key_event>();
+        while (!dec.empty())
+            ret.push_back(dec.pop());
+        return ret;
+    }
+
+    std::vector<key_event> decode(std::string_view in)
+    {
+        dec.feed(in.data(), in.size());
+        return drain();
+    }
+
+    // the same, one byte per read
+    std::vector<key_event> decode_bytewise(std::string_view in)
+    {
+        for (auto c : in)
+            dec.feed(&c, 1);
+        return drain();
+    }
+};
+
+using keys = std::vector<key_event>;
+
+TEST_F(key_decoder_test, text_passes_through)
+{
+    ASSERT_EQ(decode("ab\r\x7f"),
+            (keys{ { 'a' }, { 'b' }, { '\r' }, { editor_key::BACKSPACE } }));
+    ASSERT_FALSE(dec.pending());
+}
+
+TEST_F(key_decoder_test, cursor_and_editing_keys)
+{
+    ASSERT_EQ(decode("\x1b[A\x1b[B\x1b[C\x1b[D\x1bOH\x1b[F"),
+            (keys{ { editor_key::UP }, { editor_key::DOWN }, { editor_key::RIGHT },
+                   { editor_key::LEFT }, { editor_key::HOME }, { editor_key::END } }));
+    ASSERT_EQ(decode("\x1b[1~\x1b[2~\x1b[3~\x1b[4~\x1b[5~\x1b[6~\x1b[7~\x1b[8~"),
+            (keys{ { editor_key::HOME }, { editor_key::INSERT }, { editor_key::DEL },
+                   { editor_key::END }, { editor_key::PAGE_UP }, { editor_key::PAGE_DOWN },
+                   { editor_key::HOME }, { editor_key::END } }));
+}
+
+TEST_F(key_decoder_test, function_keys)
+{
+    ASSERT_EQ(decode("\x1bOP\x1bOS\x1b[15~\x1b[21~\x1b[24~"),
+            (keys{ { editor_key::F1 }, { editor_key::F4 }, { editor_key::F5 },
+                   { editor_key::F10 }, { editor_key::F12 } }));
+}
+
+TEST_F(key_decoder_test, modifiers)
+{
+    ASSERT_EQ(decode("\x1b[1;5C\x1b[1;2A\x1b[3;3~\x1b[Z"),
+            (keys{ { editor_key::RIGHT, key_event::CTRL }, { editor_key::UP, key_event::SHIFT },
+                   { editor_key::DEL, key_event::ALT }, { '\t', key_event::SHIFT } }));
+}
+
+TEST_F(key_decoder_test, csi_u)
+{
+    ASSERT_EQ(decode("\x1b[97;5u\x1b[13u\x1b[27u\x1b[9;2u\x1b[8364u"),
+            (keys{ { 'a' & 0x1f, key_event::CTRL }, { '\r' },
+                   { editor_key::ESCAPE }, { '\t', key_event::SHIFT } }));
+}
+
+TEST_F(key_decoder_test, alt_is_an_escape_prefix)
+{
+    ASSERT_EQ(decode("\x1b" "x\x1b\x1b[A"),
+            (keys{ { 'x', key_event::ALT }, { editor_key::ESCAPE }, { editor_key::UP } }));
+}
+
+TEST_F(key_decoder_test, sequences_split_across_reads)
+{
+    ASSERT_EQ(decode_bytewise("\x1b[1;5Ca\x1b[5~\x1bOQ"),
+            (keys{ { editor_key::RIGHT, key_event::CTRL }, { 'a' },
+                   { editor_key::PAGE_UP }, { editor_key::F2 } }));
+
+    ASSERT_TRUE(decode("\x1b[1;").empty());
+    ASSERT_TRUE(dec.pending());
+    ASSERT_EQ(decode("2B"), (keys{ { editor_key::DOWN, key_event::SHIFT } }));
+}
+
+TEST_F(key_decoder_test, unknown_sequences_are_dropped_whole)
+{
+    // an unknown key, a mouse report and a cursor position reply
+    ASSERT_EQ(decode("\x1b[99~x\x1b[<0;12;3Mx\x1b[?1;2cx\x1b[12;40Rx"),
+            (keys{ { 'x' }, { 'x' }, { 'x' }, { 'x' } }));
+}
+
+TEST_F(key_decoder_test, flush_ends_a_sequence)
+{
+    ASSERT_TRUE(decode("\x1b").empty());
+    ASSERT_TRUE(dec.pending());
+    dec.flush();
+    ASSERT_FALSE(dec.pending());
+    ASSERT_EQ(drain(), (keys{ { editor_key::ESCAPE } }));
+
+    decode("\x1b[");
+    dec.flush();
+    ASSERT_EQ(drain(), (keys{ { '[', key_event::ALT } }));
+
+    decode("\x1b[1;");
+    dec.flush();
+    ASSERT_TRUE(drain().empty());
+    ASSERT_EQ(decode("a"), (keys{ { 'a' } }));
+}
+
+TEST_F(key_decoder_test, paste_is_one_key_with_its_text)
+{
+    ASSERT_EQ(decode("a\x1b[200~x\ry\x1b[A\x1b\x1b[20z\x1b[201~b"),
+            (keys{ { 'a' }, { editor_key::PASTE }, { 'b' } }));
+    ASSERT_STREQ(dec.pop_paste().c_str(), "x\ry\x1b[A\x1b\x1b[20z");
+}
+
+TEST_F(key_decoder_test, paste_split_across_reads)
+{
+    ASSERT_TRUE(decode_bytewise("\x1b[200~one\x1b[201").empty());
+    ASSERT_FALSE(dec.pending());
+    // a paste outlasts the escape timeout
+    dec.flush();
+    ASSERT_EQ(decode_bytewise("x\x1b[201~"), (keys{ { editor_key::PASTE } }));
+    ASSERT_STREQ(dec.pop_paste().c_str(), "one\x1b[201x");
+}
+
+TEST_F(key_decoder_test, paste_without_end_is_ended)
+{
+    ASSERT_TRUE(decode("\x1b[200~one\x1b[20").empty());
+    ASSERT_TRUE(dec.pasting());
+    dec.end_paste();
+    ASSERT_FALSE(dec.pasting());
+    ASSERT_EQ(drain(), (keys{ { editor_key::PASTE } }));
+    ASSERT_STREQ(dec.pop_paste().c_str(), "one\x1b[20");
+    ASSERT_EQ(decode("a"), (keys{ { 'a' } }));
+}
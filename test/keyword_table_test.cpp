@@ -0,0 +1,48 @@
+#include <array>
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+
+#include "../src/keyword_table.hpp"
+
+static constexpr std::array<std::string_view, 10> KEYWORDS{
+    "if", "else", "for", "while", "do", "return", "int", "in", "i", "iff",
+};
+
+static constexpr keyword_table TABLE{KEYWORDS};
+
+static_assert(TABLE.contains("return"));
+static_assert(!TABLE.contains("retur"));
+static_assert(!TABLE.contains(""));
+
+TEST(keyword_table_test, contains_every_keyword)
+{
+    auto view = TABLE.view();
+    for (auto keyword : KEYWORDS) {
+        ASSERT_TRUE(TABLE.contains(keyword));
+        ASSERT_TRUE(view.contains(keyword));
+        ASSERT_TRUE(view.contains(keyword.data(), keyword.size()));
+    }
+}
+
+TEST(keyword_table_test, rejects_non_keywords)
+{
+    auto view = TABLE.view();
+    for (auto s : { "", "f", "iff ", "IF", "returns", "whil", "int_", "doo", "x" })
+        ASSERT_FALSE(view.contains(s));
+}
+
+TEST(keyword_table_test, prefix_of_longer_buffer)
+{
+    auto view = TABLE.view();
+    auto line = std::string("while(x)");
+    ASSERT_TRUE(view.contains(line.c_str(), 5));
+    ASSERT_FALSE(view.contains(line.c_str(), 6));
+    ASSERT_FALSE(view.contains(line.c_str() + 6, 0));
+}
+
+TEST(keyword_table_test, default_view_is_empty)
+{
+    auto view = keyword_view();
+    ASSERT_FALSE(view.contains("if"));
+}
@@ -0,0 +1,130 @@
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "../src/render_thread.hpp"
+#include "../src/screen.hpp"
+
+using namespace std::chrono_literals;
+
+class render_thread_test : public ::testing::Test
+{
+protected:
+    // a frame is larger than the smallest pipe buffer
+    static constexpr std::size_t ROWS = 50, COLS = 200;
+
+    // frames handed back, counted on the render thread; declared before
+    // the renderer so that it outlives the thread
+    std::atomic<int> freed{};
+    render_thread renderer;
+    int pipe_fds[2]{ -1, -1 };
+    std::string written;
+    std::thread reader;
+
+    void SetUp() override
+    {
+        ASSERT_EQ(pipe(pipe_fds), 0);
+    }
+
+    void TearDown() override
+    {
+        // the render thread may be stuck writing
+        if (!reader.joinable())
+            start_reading();
+        renderer.stop();
+        stop_reading();
+        close(pipe_fds[0]);
+    }
+
+    void start_reading()
+    {
+        reader = std::thread([this]() {
+            char buf[4096];
+            for (ssize_t n; (n = read(pipe_fds[0], buf, sizeof(buf))) > 0;)
+                written.append(buf, static_cast<std::size_t>(n));
+        });
+    }
+
+    // closes the writing end, the reader stops at the end of what was written
+    void stop_reading()
+    {
+        if (pipe_fds[1] != -1)
+            close(pipe_fds[1]);
+        pipe_fds[1] = -1;
+        if (reader.joinable())
+            reader.join();
+    }
+
+    // a frame of nothing but `c`
+    static void compose(frame& f, char c)
+    {
+        if (f.cells.rows() != ROWS)
+            f.cells.resize(ROWS, COLS);
+        for (std::size_t row = 0; row < ROWS; ++row)
+            f.cells.fill(row, 0, COLS, c);
+        f.cursor = { 0, 0 };
+        f.offset = { 0, 0 };
+        f.text_rows = ROWS - 2;
+    }
+};
+
+TEST_F(render_thread_test, writes_the_last_frame_submitted)
+{
+    start_reading();
+    renderer.start(pipe_fds[1]);
+
+    char last = 0;
+    for (int i = 0; i < 2000; ++i) {
+        auto* f = renderer.acquire();
+        if (!f)
+            continue;
+        last = static_cast<char>('a' + i % 26);
+        compose(*f, last);
+        renderer.submit(f);
+    }
+    renderer.stop();
+    stop_reading();
+
+    // the last frame differs from every other in each cell and ends the
+    // output, followed by the cursor
+    auto row = std::string(COLS, last);
+    auto at = written.rfind(row);
+    ASSERT_NE(at, std::string::npos);
+    ASSERT_EQ(written.substr(at + COLS), "\x1b[H\x1b[?25h");
+}
+
+TEST_F(render_thread_test, a_stuck_terminal_does_not_block_the_edit_thread)
+{
+    // nobody reads the pipe yet, its buffer fills up and the render thread
+    // blocks in write()
+    fcntl(pipe_fds[1], F_SETPIPE_SZ, 4096);
+    renderer.start(pipe_fds[1], [this]() { ++freed; });
+
+    int submitted = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 100; ++i) {
+        if (auto* f = renderer.acquire()) {
+            compose(*f, static_cast<char>('a' + i % 26));
+            renderer.submit(f);
+            ++submitted;
+            std::this_thread::sleep_for(1ms);
+        }
+    }
+    ASSERT_LT(std::chrono::steady_clock::now() - start, 1s);
+    // one frame is being written, the rest waits behind it; how many went
+    // out before the pipe filled up depends on the scheduling
+    ASSERT_GE(submitted, static_cast<int>(render_thread::FRAMES));
+    ASSERT_EQ(renderer.acquire(), nullptr);
+
+    // once the terminal takes its output the frames come back
+    start_reading();
+    while (freed == 0)
+        std::this_thread::sleep_for(1ms);
+    auto* f = renderer.acquire();
+    ASSERT_NE(f, nullptr);
+    renderer.submit(f);
+}
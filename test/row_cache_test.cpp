@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+
+#include "../src/editor_keys.hpp"
+#include "../src/highlight.hpp"
+#include "../src/row_cache.hpp"
+
+class row_cache_test : public ::testing::Test
+{
+protected:
+    row_cache cache;
+    const editor_syntax* syntax = &HLDB[0];
+};
+
+TEST_F(row_cache_test, identical_rows_share_results)
+{
+    auto a = cache.get("int x = 1;", syntax, {});
+    auto b = cache.get("int x = 1;", syntax, {});
+
+    ASSERT_EQ(a, b);
+    ASSERT_EQ(cache.stats().hits, 1);
+    ASSERT_EQ(cache.stats().misses, 1);
+    ASSERT_EQ(cache.stats().entries, 1);
+    ASSERT_DOUBLE_EQ(cache.stats().hit_rate(), 0.5);
+}
+
+TEST_F(row_cache_test, key_includes_syntax_and_entry_state)
+{
+    auto plain = cache.get("int x; /* y", nullptr, {});
+    auto c = cache.get("int x; /* y", syntax, {});
+    auto in_comment = cache.get("int x; /* y", syntax, hl_state{ 0, 1 });
+
+    ASSERT_NE(plain, c);
+    ASSERT_NE(c, in_comment);
+    ASSERT_TRUE(plain->hl.spans().empty());
+    ASSERT_EQ(c->exit_state, (hl_state{ 0, 1 }));
+    ASSERT_EQ(cache.stats().misses, 3);
+}
+
+TEST_F(row_cache_test, renders_tabs)
+{
+    auto content = str("\ta\tb");
+    auto r = cache.get(content, nullptr, {});
+    ASSERT_TRUE(r->has_tabs());
+    ASSERT_EQ(r->render(content), "        a       b");
+
+    // same rendering, different content
+    auto spaces = str("        a       b");
+    auto s = cache.get(spaces, nullptr, {});
+    ASSERT_NE(r, s);
+    ASSERT_EQ(s->render(spaces), r->render(content));
+}
+
+TEST_F(row_cache_test, tab_index_maps_columns)
+{
+    auto content = str("ab\tc\t\t1234567\tx");
+    auto r = cache.get(content, nullptr, {});
+    ASSERT_EQ(r->render(content), "ab      c               1234567 x");
+
+    ASSERT_EQ(r->tabs.size(), 4);
+    for (std::size_t i = 0, col = 0; i <= content.size(); ++i) {
+        ASSERT_EQ(r->render_col(i), col);
+        if (i < content.size())
+            col += content[i] == '\t' ? TABSTOP - col % TABSTOP : 1;
+    }
+}
+
+TEST_F(row_cache_test, padding_maps_back_to_its_tab)
+{
+    auto content = str("ab\tc\t\t1234567\tx");
+    auto r = cache.get(content, nullptr, {});
+    auto render = r->render(content);
+
+    for (std::size_t i = 0; i < content.size(); ++i) {
+        auto from = r->render_col(i);
+        auto to = r->render_col(i + 1);
+        for (auto col = from; col < to; ++col)
+            ASSERT_EQ(r->content_col(col), i);
+    }
+    ASSERT_EQ(r->content_col(render.size()), content.size());
+}
+
+TEST_F(row_cache_test, tab_free_rows_render_as_their_content)
+{
+    auto content = str("int x = 1;");
+    auto r = cache.get(content, syntax, {});
+
+    ASSERT_FALSE(r->has_tabs());
+    ASSERT_TRUE(r->expanded.empty());
+    ASSERT_EQ(r->render(content).data(), content.c_str());
+    ASSERT_EQ(r->hl.color_at(0), colors::RED);
+}
+
+TEST_F(row_cache_test, budget_evicts_least_recently_used)
+{
+    cache.set_budget(0);
+    auto a = cache.get("\ta", nullptr, {});
+    ASSERT_EQ(cache.stats().entries, 0);
+    ASSERT_EQ(cache.stats().evictions, 1);
+
+    cache.set_budget(row_cache::DEFAULT_BUDGET);
+    cache.get("a", nullptr, {});
+    cache.get("b", nullptr, {});
+    cache.get("a", nullptr, {});
+    auto budget = cache.stats().bytes - 1;
+    cache.set_budget(budget);
+
+    // "b" was used least recently
+    ASSERT_EQ(cache.stats().entries, 1);
+    cache.get("a", nullptr, {});
+    ASSERT_EQ(cache.stats().hits, 2);
+
+    // results handed out stay valid after eviction
+    ASSERT_STREQ(a->expanded.c_str(), "        a");
+}
+
+TEST_F(row_cache_test, a_hash_collision_is_not_a_hit)
+{
+    // rows handed in under the same hash, as if they collided
+    auto a = cache.get("int x = 1;", 42, syntax, {});
+    auto b = cache.get("/* x = 1 */", 42, syntax, {});
+    auto c = cache.get("char y = 2;", 42, syntax, {});
+
+    ASSERT_NE(a, b);
+    ASSERT_NE(b, c);
+    ASSERT_EQ(cache.stats().hits, 0);
+    ASSERT_NE(b->hl.color_at(0), c->hl.color_at(0));
+}
+
+TEST_F(row_cache_test, eviction_frees_unreferenced_results)
+{
+    auto content = str("int x = 1;");
+    auto weak = std::weak_ptr<const row_render>(
+            cache.get(content, hash_content(content.c_str(), content.size()), syntax, {}));
+    ASSERT_FALSE(weak.expired());
+
+    cache.set_budget(0);
+    ASSERT_TRUE(weak.expired());
+    ASSERT_EQ(cache.stats().bytes, 0);
+}
+
+TEST(hash_content_test, differs_on_any_byte)
+{
+    auto s = str("the quick brown fox jumps over the lazy dog");
+    auto h = hash_content(s.c_str(), s.size());
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        auto t = s;
+        t[i] ^= 1;
+        ASSERT_NE(hash_content(t.c_str(), t.size()), h);
+    }
+    ASSERT_NE(hash_content(s.c_str(), s.size() - 1), h);
+}
@@ -0,0 +1,276 @@
+#include <cctype>
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/editor_keys.hpp"
+#include "../src/screen.hpp"
+
+class screen_test : public ::testing::Test
+{
+protected:
+    std::mt19937 mt{};
+
+    void SetUp() override
+    {
+        mt.seed(std::random_device{}());
+    }
+
+    // plays `out` on `term` as a terminal would, understanding only what
+    // diff_screen may write
+    static void play(screen& term, const str& out)
+    {
+        std::size_t row = 0, col = 0;
+        std::size_t top = 0, bottom = term.rows();
+        auto color = std::uint8_t{colors::DEFAULT};
+        auto attrs = std::uint8_t{};
+        auto params = [](const char*& p) {
+            auto ret = std::vector<std::size_t>();
+            auto n = std::size_t{};
+            auto any = false;
+            for (; std::isdigit(*p) || *p == ';'; ++p) {
+                if (*p == ';') {
+                    ret.push_back(n);
+                    n = 0;
+                    any = false;
+                } else {
+                    n = n * 10 + static_cast<std::size_t>(*p - '0');
+                    any = true;
+                }
+            }
+            if (any || !ret.empty())
+                ret.push_back(n);
+            return ret;
+        };
+
+        for (const auto* p = out.c_str(); *p;) {
+            if (*p == '\r') {
+                col = 0;
+                ++p;
+            } else if (*p == '\n') {
+                ++row;
+                ++p;
+            } else if (*p == '\x1b') {
+                ASSERT_EQ(p[1], '[');
+                p += 2;
+                auto args = params(p);
+                switch (*p++) {
+                    case 'H':
+                        row = args.size() > 0 ? args[0] - 1 : 0;
+                        col = args.size() > 1 ? args[1] - 1 : 0;
+                        break;
+                    case 'r':
+                        top = args.size() > 0 ? args[0] - 1 : 0;
+                        bottom = args.size() > 1 ? args[1] : term.rows();
+                        row = col = 0;
+                        break;
+                    case 'S':
+                    case 'T':
+                        ASSERT_EQ(attrs, 0);
+                        term.scroll(top, bottom, static_cast<std::ptrdiff_t>(args.at(0))
+                                * (p[-1] == 'S' ? 1 : -1));
+                        break;
+                    case 'C':
+                        col += args.at(0);
+                        break;
+                    case 'K':
+                        ASSERT_EQ(attrs, 0);
+                        term.fill(row, col, term.cols(), ' ');
+                        break;
+                    case 'J':
+                        ASSERT_EQ(args.at(0), 2);
+                        term.clear();
+                        break;
+                    case 'm':
+                        if (args.empty()) {
+                            color = colors::DEFAULT;
+                            attrs = 0;
+                        }
+                        for (auto a : args) {
+                            if (a == 7)
+                                attrs = cell::INVERT;
+                            else if (a == 27)
+                                attrs = 0;
+                            else
+                                color = static_cast<std::uint8_t>(a);
+                        }
+                        break;
+                    default:
+                        FAIL() << "unexpected sequence";
+                }
+            } else {
+                ASSERT_LT(row, term.rows());
+                ASSERT_LT(col, term.cols());
+                term.put(row, col++, { p++, 1 }, color, attrs);
+            }
+        }
+        ASSERT_EQ(color, colors::DEFAULT);
+        ASSERT_EQ(attrs, 0);
+        ASSERT_EQ(top, 0);
+        ASSERT_EQ(bottom, term.rows());
+    }
+
+    static void expect_same(const screen& a, const screen& b)
+    {
+        ASSERT_EQ(a.rows(), b.rows());
+        ASSERT_EQ(a.cols(), b.cols());
+        for (std::size_t row = 0; row < a.rows(); ++row)
+            for (std::size_t col = 0; col < a.cols(); ++col)
+                ASSERT_EQ(a.at(row, col), b.at(row, col)) << row << ':' << col;
+    }
+
+    void scribble(screen& scr, std::size_t strokes)
+    {
+        static constexpr std::string_view glyphs = "ab ~x";
+        static constexpr int palette[] = { colors::DEFAULT, colors::RED, colors::CYAN };
+        auto pick = [&](std::size_t n) {
+            return std::uniform_int_distribution<std::size_t>(0, n - 1)(mt);
+        };
+        while (strokes--) {
+            auto row = pick(scr.rows());
+            auto col = pick(scr.cols());
+            scr.fill(row, col, 1 + pick(12), glyphs[pick(glyphs.size())],
+                    palette[pick(std::size(palette))],
+                    pick(4) ? std::uint8_t{} : cell::INVERT);
+            if (!pick(8))
+                scr.fill(row, col, scr.cols(), ' ');
+        }
+    }
+};
+
+TEST_F(screen_test, put_cuts_at_the_edge)
+{
+    auto scr = screen(2, 5);
+    ASSERT_EQ(scr.put(0, 3, "abcd", colors::RED), 5);
+    ASSERT_EQ(scr.at(0, 3).glyph, 'a');
+    ASSERT_EQ(scr.at(0, 4), (cell{ 'b', colors::RED, 0 }));
+    ASSERT_EQ(scr.at(1, 0), cell{});
+    ASSERT_EQ(scr.put(1, 7, "x"), 7);
+}
+
+TEST_F(screen_test, unchanged_frame_writes_nothing)
+{
+    auto a = screen(4, 10);
+    a.put(1, 2, "text", colors::RED);
+    auto b = a;
+
+    auto out = str();
+    diff_screen(a, b, out);
+    ASSERT_TRUE(out.empty());
+}
+
+TEST_F(screen_test, single_change_is_one_move_and_one_cell)
+{
+    auto a = screen(4, 10);
+    a.put(2, 0, "hello");
+    auto b = a;
+    b.put(2, 4, "O");
+
+    auto out = str();
+    diff_screen(a, b, out);
+    ASSERT_STREQ(out.c_str(), "\x1b[3;5HO");
+}
+
+TEST_F(screen_test, blank_tail_is_erased)
+{
+    auto a = screen(1, 20);
+    a.put(0, 0, "a long line of text");
+    auto b = screen(1, 20);
+    b.put(0, 0, "a l");
+
+    auto out = str();
+    diff_screen(a, b, out);
+    ASSERT_STREQ(out.c_str(), "\x1b[1;4H\x1b[K");
+}
+
+TEST_F(screen_test, line_with_multibyte_text_is_rewritten_whole)
+{
+    auto a = screen(2, 10);
+    a.put(1, 0, "\xc3\xa9 = 1;");
+    auto b = a;
+    b.put(1, 6, ":");
+
+    // the cell changed is a byte after é, the terminal's column before it
+    auto out = str();
+    diff_screen(a, b, out);
+    ASSERT_STREQ(out.c_str(), "\x1b[2H\xc3\xa9 = 1:\x1b[K");
+
+    // and a line that had one goes the same way
+    auto c = b;
+    c.put(1, 0, "ab");
+    out.clear();
+    diff_screen(b, c, out);
+    ASSERT_STREQ(out.c_str(), "\x1b[2Hab = 1:\x1b[K");
+}
+
+TEST_F(screen_test, diff_reproduces_next_frame)
+{
+    for (int round = 0; round < 300; ++round) {
+        auto rows = 1 + mt() % 6;
+        auto cols = 1 + mt() % 40;
+        auto prev = screen(rows, cols);
+        scribble(prev, mt() % 20);
+        auto next = prev;
+        scribble(next, mt() % 20);
+
+        // the terminal starts with whatever the previous frame left
+        auto term = prev;
+        auto out = str();
+        diff_screen(prev, next, out);
+        play(term, out);
+        expect_same(term, next);
+
+        // and with garbage when the size changed
+        auto garbage = screen(rows, cols);
+        scribble(garbage, 30);
+        out.clear();
+        diff_screen(screen(), next, out);
+        play(garbage, out);
+        expect_same(garbage, next);
+    }
+}
+
+TEST_F(screen_test, scroll_moves_lines_and_blanks_the_rest)
+{
+    auto scr = screen(5, 3);
+    for (std::size_t row = 0; row < scr.rows(); ++row)
+        scr.fill(row, 0, 3, static_cast<char>('a' + row));
+
+    scr.scroll(1, 4, 1);
+    ASSERT_EQ(scr.at(0, 0).glyph, 'a');
+    ASSERT_EQ(scr.at(1, 0).glyph, 'c');
+    ASSERT_EQ(scr.at(2, 0).glyph, 'd');
+    ASSERT_EQ(scr.at(3, 0), cell{});
+    ASSERT_EQ(scr.at(4, 0).glyph, 'e');
+
+    scr.scroll(0, 3, -2);
+    ASSERT_EQ(scr.at(0, 0), cell{});
+    ASSERT_EQ(scr.at(1, 0), cell{});
+    ASSERT_EQ(scr.at(2, 0).glyph, 'a');
+    ASSERT_EQ(scr.at(3, 0), cell{});
+}
+
+TEST_F(screen_test, scrolled_frame_only_draws_lines_scrolled_in)
+{
+    for (std::ptrdiff_t n : { 1, 3, -1, -3 }) {
+        auto prev = screen(12, 30);
+        scribble(prev, 60);
+        auto next = prev;
+        // the last line stays put, like the status bar
+        next.scroll(0, 11, n);
+        auto in_from = n > 0 ? 11 - static_cast<std::size_t>(n) : 0;
+        for (std::size_t row = in_from; row < in_from + static_cast<std::size_t>(n > 0 ? n : -n); ++row)
+            next.fill(row, 0, 30, 'z', colors::RED);
+
+        auto term = prev;
+        auto shown = prev;
+        auto out = str();
+        scroll_lines(shown, 0, 11, n, out);
+        diff_screen(shown, next, out);
+        play(term, out);
+        expect_same(term, next);
+        ASSERT_LT(out.size(), 20 + 40 * static_cast<std::size_t>(n > 0 ? n : -n));
+    }
+}
@@ -0,0 +1,46 @@
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "../src/spsc_queue.hpp"
+
+TEST(spsc_queue_test, holds_up_to_its_capacity_in_order)
+{
+    auto q = spsc_queue<int, 4>();
+    ASSERT_FALSE(q.pop());
+    for (int i = 0; i < 4; ++i)
+        ASSERT_TRUE(q.push(i));
+    ASSERT_FALSE(q.push(4));
+
+    ASSERT_EQ(q.pop(), 0);
+    ASSERT_TRUE(q.push(4));
+    for (int i = 1; i <= 4; ++i)
+        ASSERT_EQ(q.pop(), i);
+    ASSERT_FALSE(q.pop());
+}
+
+TEST(spsc_queue_test, hands_items_across_threads_in_order)
+{
+    static constexpr std::size_t COUNT = 200'000;
+    auto q = spsc_queue<std::size_t, 64>();
+    auto producer = std::thread([&]() {
+        for (std::size_t i = 0; i < COUNT;) {
+            if (q.push(i))
+                ++i;
+            else
+                std::this_thread::yield();
+        }
+    });
+
+    std::size_t expected = 0;
+    while (expected < COUNT) {
+        if (auto item = q.pop()) {
+            ASSERT_EQ(*item, expected);
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    ASSERT_FALSE(q.pop());
+}
@@ -398,6 +398,23 @@ TEST_F(str_test, append3)
     }
 }
 
+TEST_F(str_test, append_span_with_nul)
+{
+    const char text[] = "a\0b\tc";
+    s.append(text, sizeof(text) - 1);
+    stls.append(text, sizeof(text) - 1);
+    ASSERT_EQ(s.size(), stls.size());
+    ASSERT_EQ(std::memcmp(s.c_str(), stls.c_str(), s.size() + 1), 0);
+
+    auto copy = str();
+    copy.append(s);
+    ASSERT_EQ(copy.size(), s.size());
+
+    // a C string still ends at its NUL
+    copy.append(text);
+    ASSERT_EQ(copy.size(), s.size() + 1);
+}
+
 TEST_F(str_test, append_iter1)
 {
     auto buf = str();
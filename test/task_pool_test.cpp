@@ -0,0 +1,147 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <gtest/gtest.h>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../src/task_pool.hpp"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    // spins until `pred` holds or a few seconds passed, returns `pred()`
+    template<typename fn>
+    bool eventually(fn pred)
+    {
+        auto deadline = std::chrono::steady_clock::now() + 5s;
+        while (!pred() && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::yield();
+        return pred();
+    }
+
+    // keeps the worker that runs it busy until released
+    struct blocker
+    {
+        std::atomic<bool> running{}, released{};
+
+        task_pool::task task()
+        {
+            return [this]() {
+                running = true;
+                while (!released)
+                    std::this_thread::yield();
+            };
+        }
+    };
+}
+
+TEST(task_pool_test, parallel_for_covers_every_index_once)
+{
+    auto pool = task_pool(4);
+    auto hits = std::vector<std::atomic<int>>(10'000);
+    ASSERT_TRUE(pool.parallel_for(3, hits.size(), 7, [&](std::size_t from, std::size_t to) {
+        ASSERT_LE(to - from, 7);
+        for (auto i = from; i < to; ++i)
+            ++hits[i];
+    }));
+
+    for (std::size_t i = 0; i < hits.size(); ++i)
+        ASSERT_EQ(hits[i], i < 3 ? 0 : 1) << i;
+    ASSERT_TRUE(pool.parallel_for(5, 5, 1, [](std::size_t, std::size_t) { FAIL(); }));
+}
+
+TEST(task_pool_test, interactive_tasks_run_before_background_ones)
+{
+    auto pool = task_pool(1);
+    auto busy = blocker();
+    pool.submit(busy.task());
+    ASSERT_TRUE(eventually([&]() { return busy.running.load(); }));
+
+    auto mutex = std::mutex();
+    auto order = std::vector<task_priority>();
+    auto record = [&](task_priority priority) {
+        return [&, priority]() {
+            auto lock = std::lock_guard(mutex);
+            order.push_back(priority);
+        };
+    };
+    for (auto priority : { task_priority::BACKGROUND, task_priority::INTERACTIVE,
+            task_priority::BACKGROUND, task_priority::INTERACTIVE })
+        pool.submit(record(priority), priority);
+    busy.released = true;
+
+    ASSERT_TRUE(eventually([&]() {
+        auto lock = std::lock_guard(mutex);
+        return order.size() == 4;
+    }));
+    ASSERT_EQ(order, (std::vector<task_priority>{ task_priority::INTERACTIVE,
+                task_priority::INTERACTIVE, task_priority::BACKGROUND, task_priority::BACKGROUND }));
+}
+
+TEST(task_pool_test, cancelled_work_does_not_start)
+{
+    auto pool = task_pool(1);
+    auto busy = blocker();
+    pool.submit(busy.task());
+    ASSERT_TRUE(eventually([&]() { return busy.running.load(); }));
+
+    auto token = cancel_token();
+    auto ran = std::atomic<bool>();
+    auto after = std::atomic<bool>();
+    pool.submit([&]() { ran = true; }, task_priority::BACKGROUND, token);
+    pool.submit([&]() { after = true; });
+    token.cancel();
+    busy.released = true;
+
+    ASSERT_TRUE(eventually([&]() { return after.load(); }));
+    ASSERT_FALSE(ran);
+
+    auto ranges = std::atomic<int>();
+    ASSERT_FALSE(pool.parallel_for(0, 100, 1, [&](std::size_t, std::size_t) { ++ranges; },
+                task_priority::INTERACTIVE, token));
+    ASSERT_EQ(ranges, 0);
+}
+
+TEST(task_pool_test, idle_workers_steal_from_a_busy_one)
+{
+    static constexpr int TASKS = 16;
+    auto pool = task_pool(2);
+    auto done = std::atomic<int>();
+    auto stolen = std::atomic<bool>();
+
+    // every task goes to the queue of the worker that submits them, which
+    // then waits for them without running any itself
+    pool.submit([&]() {
+        for (int i = 0; i < TASKS; ++i)
+            pool.submit([&]() { ++done; });
+        stolen = eventually([&]() { return done == TASKS; });
+    });
+
+    ASSERT_TRUE(eventually([&]() { return stolen.load(); }));
+    ASSERT_EQ(done, TASKS);
+}
+
+TEST(task_pool_test, parallel_for_in_a_task_and_exceptions)
+{
+    auto pool = task_pool(2);
+    auto sum = std::atomic<std::size_t>();
+    auto finished = std::atomic<bool>();
+    pool.submit([&]() {
+        pool.parallel_for(0, 1000, 10, [&](std::size_t from, std::size_t to) {
+            for (auto i = from; i < to; ++i)
+                sum += i;
+        });
+        finished = true;
+    });
+    ASSERT_TRUE(eventually([&]() { return finished.load(); }));
+    ASSERT_EQ(sum, 999 * 1000 / 2);
+
+    ASSERT_THROW(pool.parallel_for(0, 100, 1, [](std::size_t from, std::size_t) {
+        if (from == 42)
+            throw std::runtime_error("range 42");
+    }), std::runtime_error);
+}
@@ -0,0 +1,122 @@
+#include <chrono>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "../src/timer_wheel.hpp"
+
+using namespace std::chrono_literals;
+
+class timer_wheel_test : public ::testing::Test
+{
+protected:
+    using clock = timer_wheel::clock;
+
+    timer_wheel wheel;
+    clock::time_point t0 = clock::time_point{} + 1h;
+    std::vector<int> fired;
+
+    timer_wheel::handler record(int n)
+    { return [this, n]() { fired.push_back(n); }; }
+
+    void SetUp() override
+    {
+        ASSERT_EQ(wheel.advance(t0), 0);
+    }
+};
+
+TEST_F(timer_wheel_test, runs_timers_once_due_earliest_first)
+{
+    wheel.schedule(t0 + 30ms, record(3));
+    wheel.schedule(t0 + 10ms, record(1));
+    wheel.schedule(t0 + 20ms, record(2));
+    ASSERT_EQ(wheel.size(), 3);
+    ASSERT_EQ(wheel.next_expiry(), t0 + 10ms);
+
+    ASSERT_EQ(wheel.advance(t0 + 9ms), 0);
+    ASSERT_EQ(wheel.advance(t0 + 25ms), 2);
+    ASSERT_EQ(fired, (std::vector<int>{ 1, 2 }));
+    ASSERT_EQ(wheel.next_expiry(), t0 + 30ms);
+
+    ASSERT_EQ(wheel.advance(t0 + 30ms), 1);
+    ASSERT_EQ(fired, (std::vector<int>{ 1, 2, 3 }));
+    ASSERT_EQ(wheel.size(), 0);
+    ASSERT_FALSE(wheel.next_expiry());
+}
+
+TEST_F(timer_wheel_test, deadlines_round_up_to_a_tick)
+{
+    wheel.schedule(t0 + 10ms + 1us, record(1));
+    ASSERT_EQ(wheel.next_expiry(), t0 + 11ms);
+    ASSERT_EQ(wheel.advance(t0 + 10ms + 500us), 0);
+    ASSERT_EQ(wheel.advance(t0 + 11ms), 1);
+
+    // one already due runs on the next advance
+    wheel.schedule(t0, record(2));
+    ASSERT_LE(*wheel.next_expiry(), t0 + 12ms);
+    ASSERT_EQ(wheel.advance(t0 + 12ms), 1);
+}
+
+TEST_F(timer_wheel_test, timers_laps_away_share_slots)
+{
+    auto lap = timer_wheel::TICK * timer_wheel::SLOTS;
+    wheel.schedule(t0 + 3 * lap + 5ms, record(3));
+    wheel.schedule(t0 + lap + 5ms, record(1));
+    wheel.schedule(t0 + 5ms, record(0));
+    ASSERT_EQ(wheel.next_expiry(), t0 + 5ms);
+
+    ASSERT_EQ(wheel.advance(t0 + 5ms), 1);
+    ASSERT_EQ(wheel.next_expiry(), t0 + lap + 5ms);
+    // a wait longer than a lap still finds every due timer
+    ASSERT_EQ(wheel.advance(t0 + 10 * lap), 2);
+    ASSERT_EQ(fired, (std::vector<int>{ 0, 1, 3 }));
+}
+
+TEST_F(timer_wheel_test, cancelled_timers_do_not_run)
+{
+    auto a = wheel.schedule(t0 + 5ms, record(1));
+    auto b = wheel.schedule(t0 + 5ms, record(2));
+    ASSERT_TRUE(wheel.cancel(a));
+    ASSERT_FALSE(wheel.cancel(a));
+    ASSERT_EQ(wheel.size(), 1);
+
+    // a handler cancelling one due in the same advance
+    auto c = timer_wheel::id();
+    wheel.schedule(t0 + 6ms, [&]() { fired.push_back(3); ASSERT_TRUE(wheel.cancel(c)); });
+    c = wheel.schedule(t0 + 7ms, record(4));
+    ASSERT_EQ(wheel.advance(t0 + 10ms), 2);
+    ASSERT_EQ(fired, (std::vector<int>{ 2, 3 }));
+    ASSERT_FALSE(wheel.cancel(b));
+    ASSERT_EQ(wheel.size(), 0);
+}
+
+TEST_F(timer_wheel_test, handlers_schedule_for_a_later_advance)
+{
+    wheel.schedule(t0 + 1ms, [&]() {
+        fired.push_back(1);
+        wheel.schedule(t0, record(2));
+    });
+    ASSERT_EQ(wheel.advance(t0 + 1ms), 1);
+    ASSERT_EQ(wheel.size(), 1);
+    ASSERT_EQ(wheel.advance(t0 + 2ms), 1);
+    ASSERT_EQ(fired, (std::vector<int>{ 1, 2 }));
+}
+
+TEST_F(timer_wheel_test, debounce_runs_once_the_pokes_pause)
+{
+    auto d = debounce(wheel);
+    auto now = clock::now();
+    wheel.advance(now);
+    for (int i = 0; i < 5; ++i)
+        d.poke(100ms, record(i));
+    ASSERT_TRUE(d.pending());
+    ASSERT_EQ(wheel.size(), 1);
+
+    ASSERT_EQ(wheel.advance(now + 200ms), 1);
+    ASSERT_EQ(fired, (std::vector<int>{ 4 }));
+    ASSERT_FALSE(d.pending());
+
+    d.poke(100ms, record(5));
+    d.cancel();
+    ASSERT_EQ(wheel.advance(now + 400ms), 0);
+    ASSERT_EQ(wheel.size(), 0);
+}